@@ -0,0 +1,324 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 9:12:31am
+    Author:  Christian Ahrens
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include "../../Source/AppConfigurationBase.h"
+
+#include <iostream>
+
+namespace AppBasicsBenchmark
+{
+
+//==============================================================================
+/*
+    Synthetic configuration used by the benchmark. Since there is no JUCEApplication
+    instance in a console application, the root tag name is provided explicitly.
+*/
+class BenchmarkConfig : public JUCEAppBasics::AppConfigurationBase
+{
+public:
+    struct Options
+    {
+        bool            binarySnapshot{ false };
+        bool            lazySectionParsing{ false };
+        bool            compressed{ false };
+        bool            memoryStorage{ false };
+        PersistenceMode persistenceMode{ PM_FullSnapshot };
+    };
+
+    BenchmarkConfig(const File& file, const Options& options)
+    {
+        SetBinarySnapshotEnabled(options.binarySnapshot);
+        SetLazySectionParsingEnabled(options.lazySectionParsing);
+        SetPersistenceMode(options.persistenceMode);
+
+        if (options.memoryStorage)
+        {
+            // start from the config file's content, without touching the disk afterwards
+            auto storage = std::make_unique<JUCEAppBasics::MemoryConfigurationStorage>();
+            MemoryBlock configData;
+            if (file.loadFileAsData(configData))
+                storage->writeAtomically(file.getFileName(), [&configData](OutputStream& stream) { stream.write(configData.getData(), configData.getSize()); });
+
+            InitializeBase(std::move(storage), file.getFileName(), Version(), options.compressed);
+        }
+        else
+            InitializeBase(file, Version(), options.compressed);
+    }
+
+    ~BenchmarkConfig() override {}
+
+    String getRootTagName() const override
+    {
+        return "AppBasicsBenchmark";
+    }
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BenchmarkConfig)
+};
+
+//==============================================================================
+/*
+    Dumper that modifies a single element of the configuration per dump,
+    like a UI component dumping its state on user interaction.
+*/
+class BenchmarkDumper : public JUCEAppBasics::AppConfigurationBase::Dumper
+{
+public:
+    BenchmarkDumper(JUCEAppBasics::AppConfigurationBase& config, int numElements)
+        : m_config(config), m_numElements(numElements)
+    {
+    }
+
+    void performConfigurationDump() override;
+
+private:
+    JUCEAppBasics::AppConfigurationBase&    m_config;
+    int                                     m_numElements{ 0 };
+    int                                     m_revision{ 0 };
+};
+
+//==============================================================================
+static const String s_keyAttributeName{ "id" };
+
+static std::unique_ptr<XmlElement> createChannelXml(int id, int revision)
+{
+    auto channelXml = std::make_unique<XmlElement>("Channel");
+    channelXml->setAttribute(s_keyAttributeName, id);
+    channelXml->setAttribute("name", "Channel " + String(id));
+    channelXml->setAttribute("gain", -6.0 + 0.01 * (id % 600));
+    channelXml->setAttribute("mute", (id + revision) % 2 == 0);
+    channelXml->setAttribute("revision", revision);
+
+    auto routingXml = channelXml->createNewChildElement("Routing");
+    routingXml->setAttribute("output", id % 64);
+    routingXml->setAttribute("colour", Colour(uint32(0xff000000 | (id * 2654435761u))).toString());
+
+    return channelXml;
+}
+
+void BenchmarkDumper::performConfigurationDump()
+{
+    // negative revisions never match the ones written by the replace pass, so every dump changes the element
+    ++m_revision;
+    m_config.setConfigState(createChannelXml(m_revision % m_numElements, -m_revision), s_keyAttributeName);
+}
+
+template <typename Function>
+static double measureMs(Function&& function)
+{
+    auto startTime = Time::getMillisecondCounterHiRes();
+    function();
+    return Time::getMillisecondCounterHiRes() - startTime;
+}
+
+static int64 getStoredSize(const JUCEAppBasics::AppConfigurationBase& config, const String& suffix = {})
+{
+    return config.getStorage()->getSize(config.getConfigName() + suffix);
+}
+
+//==============================================================================
+/*
+    Measures loading, modifying, copying and flushing a configuration of the
+    given size with the given options, based on the config file written before.
+*/
+static var runVariant(const String& name, const File& configFile, const BenchmarkConfig::Options& options, int numElements, int revision)
+{
+    if ((options.binarySnapshot || options.compressed) && !options.memoryStorage)
+    {
+        // a first load creates the binary snapshot or compressed file that the measured load is based on
+        auto config = std::make_unique<BenchmarkConfig>(configFile, options);
+        config->flushToDiskAsync().get();
+    }
+
+    auto result = new DynamicObject();
+    result->setProperty("name", name);
+
+    std::unique_ptr<BenchmarkConfig> config;
+    result->setProperty("loadMs", measureMs([&] { config = std::make_unique<BenchmarkConfig>(configFile, options); }));
+
+    // the library's own measurement of reading and parsing, without the rest of the initialization
+    auto loadMetrics = config->getMetrics();
+    result->setProperty("parseMs", loadMetrics.loadTimeUs.getSum() / 1000.0);
+    result->setProperty("loadedFromBinarySnapshot", loadMetrics.binarySnapshotLoads > 0);
+
+    // replace every element once, with a revision differing from the previous variant's
+    auto replaceMs = measureMs([&] {
+        for (int id = 0; id < numElements; ++id)
+            config->setConfigState(createChannelXml(id, revision), s_keyAttributeName);
+    });
+    result->setProperty("replaceOpsPerSecond", numElements / jmax(0.001, replaceMs) * 1000.0);
+    config->flushToDiskAsync().get();
+
+    // copy out a single section and the whole configuration
+    auto sectionCopyRepetitions = 1000;
+    auto sectionCopyMs = measureMs([&] {
+        for (int i = 0; i < sectionCopyRepetitions; ++i)
+            config->getConfigState("Channel");
+    });
+    result->setProperty("getConfigStateSectionMs", sectionCopyMs / sectionCopyRepetitions);
+
+    auto fullCopyRepetitions = jlimit(1, 100, 100000 / numElements);
+    auto fullCopyMs = measureMs([&] {
+        for (int i = 0; i < fullCopyRepetitions; ++i)
+            config->getConfigState();
+    });
+    result->setProperty("getConfigStateFullMs", fullCopyMs / fullCopyRepetitions);
+
+    // dump a single modified element and wait until it is durable on disk
+    auto dumper = BenchmarkDumper(*config, numElements);
+
+    auto flushRepetitions = 10;
+    auto dumpMs = 0.0;
+    auto flushToDiskMs = 0.0;
+    auto bytesWritten = int64(0);
+    for (int i = 0; i < flushRepetitions; ++i)
+    {
+        auto deltaJournalSize = getStoredSize(*config, ".delta");
+
+        auto startTime = Time::getMillisecondCounterHiRes();
+        dumper.performConfigurationDump();
+        auto flushed = config->flushToDiskAsync();
+        dumpMs += Time::getMillisecondCounterHiRes() - startTime;
+        flushed.get();
+        flushToDiskMs += Time::getMillisecondCounterHiRes() - startTime;
+
+        if (options.persistenceMode == BenchmarkConfig::PM_DeltaJournal && getStoredSize(*config, ".delta") >= deltaJournalSize)
+            bytesWritten += getStoredSize(*config, ".delta") - deltaJournalSize;
+        else
+            bytesWritten += getStoredSize(*config) + (options.binarySnapshot ? getStoredSize(*config, ".bin") : 0);
+    }
+
+    result->setProperty("dumpMs", dumpMs / flushRepetitions);
+    result->setProperty("flushToDiskMs", flushToDiskMs / flushRepetitions);
+    result->setProperty("bytesWrittenPerFlush", bytesWritten / flushRepetitions);
+    result->setProperty("fileBytes", getStoredSize(*config));
+
+    return var(result);
+}
+
+static var runSize(const File& workingDirectory, int numElements)
+{
+    auto configFile = workingDirectory.getChildFile("Benchmark" + String(numElements) + ".config");
+
+    auto result = new DynamicObject();
+    result->setProperty("elements", numElements);
+
+    // populate an empty configuration, which also provides the config file for the variants
+    {
+        auto config = std::make_unique<BenchmarkConfig>(configFile, BenchmarkConfig::Options());
+
+        auto insertMs = measureMs([&] {
+            for (int id = 0; id < numElements; ++id)
+                config->setConfigState(createChannelXml(id, 0), s_keyAttributeName);
+        });
+        result->setProperty("insertOpsPerSecond", numElements / jmax(0.001, insertMs) * 1000.0);
+        result->setProperty("initialFlushToDiskMs", measureMs([&] { config->flushToDiskAsync().get(); }));
+    }
+
+    auto variants = Array<var>();
+
+    variants.add(runVariant("xml", configFile, BenchmarkConfig::Options(), numElements, variants.size() + 1));
+
+    auto binarySnapshotOptions = BenchmarkConfig::Options();
+    binarySnapshotOptions.binarySnapshot = true;
+    variants.add(runVariant("binarySnapshot", configFile, binarySnapshotOptions, numElements, variants.size() + 1));
+    configFile.getSiblingFile(configFile.getFileName() + ".bin").deleteFile();
+
+    auto lazySectionParsingOptions = BenchmarkConfig::Options();
+    lazySectionParsingOptions.lazySectionParsing = true;
+    variants.add(runVariant("lazySectionParsing", configFile, lazySectionParsingOptions, numElements, variants.size() + 1));
+
+    auto deltaJournalOptions = BenchmarkConfig::Options();
+    deltaJournalOptions.persistenceMode = BenchmarkConfig::PM_DeltaJournal;
+    variants.add(runVariant("deltaJournal", configFile, deltaJournalOptions, numElements, variants.size() + 1));
+
+    auto memoryStorageOptions = BenchmarkConfig::Options();
+    memoryStorageOptions.memoryStorage = true;
+    variants.add(runVariant("memoryStorage", configFile, memoryStorageOptions, numElements, variants.size() + 1));
+
+    // last, since it leaves the config file compressed
+    auto compressedOptions = BenchmarkConfig::Options();
+    compressedOptions.compressed = true;
+    variants.add(runVariant("compressed", configFile, compressedOptions, numElements, variants.size() + 1));
+
+    result->setProperty("variants", variants);
+
+    return var(result);
+}
+
+}
+
+//==============================================================================
+/*
+    Usage: AppBasicsBenchmark [--sizes 10,100,1000] [--output results.json]
+    The results are printed to stdout as JSON and optionally written to the given file.
+*/
+int main (int argc, char* argv[])
+{
+    using namespace AppBasicsBenchmark;
+
+    auto sizes = Array<int>({ 10, 100, 1000, 10000, 100000 });
+    auto outputFile = File();
+
+    auto arguments = StringArray();
+    for (int i = 1; i < argc; ++i)
+        arguments.add(argv[i]);
+
+    for (int i = 0; i < arguments.size(); ++i)
+    {
+        if (arguments[i] == "--sizes" && i + 1 < arguments.size())
+        {
+            sizes.clear();
+            for (auto const& size : StringArray::fromTokens(arguments[++i], ",", ""))
+                if (size.getIntValue() > 0)
+                    sizes.add(size.getIntValue());
+        }
+        else if (arguments[i] == "--output" && i + 1 < arguments.size())
+            outputFile = File::getCurrentWorkingDirectory().getChildFile(arguments[++i]);
+        else
+        {
+            std::cerr << "Usage: AppBasicsBenchmark [--sizes 10,100,1000] [--output results.json]" << std::endl;
+            return 1;
+        }
+    }
+
+    auto workingDirectory = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("AppBasicsBenchmark", "");
+    if (workingDirectory.createDirectory().failed())
+    {
+        std::cerr << "Unable to create " << workingDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    auto results = Array<var>();
+    for (auto numElements : sizes)
+        results.add(runSize(workingDirectory, numElements));
+
+    workingDirectory.deleteRecursively();
+
+    auto report = new DynamicObject();
+    report->setProperty("benchmark", "AppBasicsBenchmark");
+    report->setProperty("juceVersion", SystemStats::getJUCEVersion());
+    report->setProperty("operatingSystem", SystemStats::getOperatingSystemName());
+    report->setProperty("timestamp", Time::getCurrentTime().toISO8601(true));
+    report->setProperty("results", results);
+
+    auto reportJson = JSON::toString(var(report));
+    std::cout << reportJson << std::endl;
+
+    if (outputFile != File() && !outputFile.replaceWithText(reportJson))
+    {
+        std::cerr << "Unable to write " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -9,296 +9,4316 @@
 */
 
 #include "AppConfigurationBase.h"
+#include "AppConfigurationHashing.h"
 
+#include <cmath>
+#include <cstring>
 #include <mutex>
 
+#if JUCE_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 namespace JUCEAppBasics
 {
 
 AppConfigurationBase* AppConfigurationBase::m_singleton = nullptr;
 
+static juce::uint64 hashString(juce::uint64 hash, const juce::String& string)
+{
+	// the terminating zero separates consecutive strings
+	return hashBytes(hash, string.toRawUTF8(), string.getNumBytesAsUTF8() + 1);
+}
 
-AppConfigurationBase::AppConfigurationBase()
+static juce::uint64 hashValue(juce::uint64 hash, juce::uint64 value)
 {
-	if (m_singleton)
-		jassertfalse;
-	m_singleton = this;
+	return hashBytes(hash, &value, sizeof(value));
 }
 
-AppConfigurationBase::~AppConfigurationBase()
+static juce::uint64 hashAttributes(const juce::XmlElement& xml)
 {
-	TeardownFileFlushThread();
+	auto hash = s_fnvOffsetBasis;
+	for (int i = 0; i < xml.getNumAttributes(); ++i)
+	{
+		hash = hashString(hash, xml.getAttributeName(i));
+		hash = hashString(hash, xml.getAttributeValue(i));
+	}
+	return hash;
 }
 
-void AppConfigurationBase::InitializeBase(const juce::File& file, const Version& configVersion)
+/**
+ * Output stream forwarding everything written to a target stream, while hashing the written bytes.
+ * Used to recognize the config file written by this process when monitoring it for external changes.
+ */
+class HashingOutputStream : public juce::OutputStream
 {
-	m_file = std::make_unique<juce::File>(file);
-	m_configVersion = configVersion;
+public:
+	explicit HashingOutputStream(juce::OutputStream& target) : m_target(target) {};
 
-	if (!exists() && !create())
-		jassertfalse;
+	void flush() override { m_target.flush(); };
+	bool setPosition(juce::int64) override { return false; };
+	juce::int64 getPosition() override { return m_target.getPosition(); };
+	bool write(const void* data, size_t numBytes) override
+	{
+		m_hash = hashBytes(m_hash, data, numBytes);
+		return m_target.write(data, numBytes);
+	};
 
-	if (!initializeFromDisk())
-		jassertfalse;
+	juce::uint64 getHash() const { return m_hash; };
 
-	if (!flush(false))
-		jassertfalse;
+private:
+	juce::OutputStream&	m_target;
+	juce::uint64		m_hash{ s_fnvOffsetBasis };
+};
 
-	SetupFileFlushThread();
-}
+//==============================================================================
+// patched snapshot sections are cloned instead of chaining more patches, to bound the cost of reading them
+static constexpr size_t s_maxChainedConfigPatches = 64;
 
-void AppConfigurationBase::SetupFileFlushThread()
+//==============================================================================
+static constexpr int s_binarySnapshotMagic = 0x53424341; // "ACBS"
+static constexpr int s_binarySnapshotFormatVersion = 1;
+
+static void writeBinaryXml(juce::OutputStream& stream, const juce::XmlElement& xml)
 {
-	m_fileFlushThreadActive.store(true);
-	m_fileFlushThread = std::make_unique<std::thread>([this]()
-		{
-			std::unique_lock<std::mutex> fileflushlock(m_fileFlushCVMutex);
-			while (m_fileFlushThreadActive.load())
-			{
-				m_fileFlushCV.wait(fileflushlock);
+	if (xml.isTextElement())
+	{
+		stream.writeBool(true);
+		stream.writeString(xml.getText());
+		return;
+	}
 
-				std::lock_guard<std::mutex> xmlaccesslock(m_xmlCopyAccessMutex);
-				if (!m_xmlFileFlushCopy)
-				{
-					// Ending up here would mean that the AppConfigurationBase instance
-					// seemingly no longer exists, but this thread is still running, which
-					// is unecpected and should not happen!
-					jassertfalse;
-					break;
-				}
-				if (!m_xmlFileFlushCopy->writeTo(*m_file.get()))
-					jassertfalse;
-			}
-		});
+	stream.writeBool(false);
+	stream.writeString(xml.getTagName());
+	stream.writeCompressedInt(xml.getNumAttributes());
+	for (int i = 0; i < xml.getNumAttributes(); ++i)
+	{
+		stream.writeString(xml.getAttributeName(i));
+		stream.writeString(xml.getAttributeValue(i));
+	}
+	stream.writeCompressedInt(xml.getNumChildElements());
+	for (auto childElement : xml.getChildIterator())
+		writeBinaryXml(stream, *childElement);
 }
 
-void AppConfigurationBase::TeardownFileFlushThread()
+static void writeBinaryXml(juce::OutputStream& stream, const juce::XmlElement& rootXml, const std::vector<const juce::XmlElement*>& sectionXmls)
 {
+	// equivalent to writing the root with the sections as its children
+	stream.writeBool(false);
+	stream.writeString(rootXml.getTagName());
+	stream.writeCompressedInt(rootXml.getNumAttributes());
+	for (int i = 0; i < rootXml.getNumAttributes(); ++i)
 	{
-		std::lock_guard<std::mutex> fileflushlock(m_fileFlushCVMutex);
-		m_fileFlushThreadActive.store(false);
+		stream.writeString(rootXml.getAttributeName(i));
+		stream.writeString(rootXml.getAttributeValue(i));
 	}
-	m_fileFlushCV.notify_all();
-	if (m_fileFlushThread)
-		m_fileFlushThread->join();
+	stream.writeCompressedInt(int(sectionXmls.size()));
+	for (auto sectionXml : sectionXmls)
+		writeBinaryXml(stream, *sectionXml);
 }
 
-AppConfigurationBase* AppConfigurationBase::getInstance() noexcept
+static std::unique_ptr<juce::XmlElement> readBinaryXml(juce::InputStream& stream)
 {
-	if (m_singleton == nullptr)
+	if (stream.isExhausted())
+		return nullptr;
+
+	if (stream.readBool())
+		return std::unique_ptr<juce::XmlElement>(juce::XmlElement::createTextElement(stream.readString()));
+
+	auto tagName = stream.readString();
+	if (tagName.isEmpty())
+		return nullptr;
+
+	auto xml = std::make_unique<juce::XmlElement>(tagName);
+	auto numAttributes = stream.readCompressedInt();
+	if (numAttributes < 0)
+		return nullptr;
+	for (int i = 0; i < numAttributes && !stream.isExhausted(); ++i)
 	{
-		DBG("The configuration object was not yet created! Please make shure to do so in your derived class!");
-		jassertfalse;
+		auto attributeName = stream.readString();
+		xml->setAttribute(attributeName, stream.readString());
 	}
 
-	return m_singleton;
+	auto numChildElements = stream.readCompressedInt();
+	if (numChildElements < 0)
+		return nullptr;
+	for (int i = 0; i < numChildElements; ++i)
+	{
+		auto childElement = readBinaryXml(stream);
+		if (!childElement)
+			return nullptr;
+		xml->addChildElement(childElement.release());
+	}
+
+	return xml;
 }
 
-juce::String AppConfigurationBase::getDefaultConfigFilePath() noexcept
+
+static int skipPastSequence(const char* data, int size, int pos, const char* sequence)
 {
-	static juce::String s_configPath{ juce::File::getSpecialLocation(juce::File::SpecialLocationType::userApplicationDataDirectory).getFullPathName() + "/"
-										+ juce::JUCEApplication::getInstance()->getApplicationName() + "/"
-										+ juce::JUCEApplication::getInstance()->getApplicationName() + ".config" };
+	auto sequenceLength = int(std::strlen(sequence));
+	for (; pos + sequenceLength <= size; ++pos)
+		if (std::memcmp(data + pos, sequence, size_t(sequenceLength)) == 0)
+			return pos + sequenceLength;
 
-	return s_configPath;
+	return -1;
 }
 
-bool AppConfigurationBase::isValid()
+static bool startsWithSequence(const char* data, int size, int pos, const char* sequence)
 {
-	return isValid(m_xml);
+	auto sequenceLength = int(std::strlen(sequence));
+	return pos + sequenceLength <= size && std::memcmp(data + pos, sequence, size_t(sequenceLength)) == 0;
 }
 
-bool AppConfigurationBase::isValid(const std::unique_ptr<juce::XmlElement>& xmlConfiguration)
+/**
+ * Skips an xml start or end tag, starting at its opening '<', while respecting quoted attribute values.
+ * @return	The position after the closing '>', or -1 if the tag is not terminated.
+ */
+static int skipTag(const char* data, int size, int pos, bool& isSelfClosing)
 {
-	if (!xmlConfiguration)
-		return false;
-
-	if (!xmlConfiguration->hasTagName(juce::JUCEApplication::getInstance()->getApplicationName()))
-		return false;
+	char quote = 0;
+	for (++pos; pos < size; ++pos)
+	{
+		auto c = data[pos];
+		if (quote != 0)
+		{
+			if (c == quote)
+				quote = 0;
+		}
+		else if (c == '"' || c == '\'')
+			quote = c;
+		else if (c == '>')
+		{
+			isSelfClosing = (data[pos - 1] == '/');
+			return pos + 1;
+		}
+	}
 
-	return true;
+	return -1;
 }
 
-bool AppConfigurationBase::exists()
+/**
+ * Skips markup that is not an element, i.e. comments, CDATA, processing instructions and declarations.
+ * @return	The position after the markup, the unchanged position if there is no such markup, or -1 if it is not terminated.
+ */
+static int skipNonElementMarkup(const char* data, int size, int pos)
 {
-	return m_file->exists();
+	if (startsWithSequence(data, size, pos, "<!--"))
+		return skipPastSequence(data, size, pos, "-->");
+	if (startsWithSequence(data, size, pos, "<![CDATA["))
+		return skipPastSequence(data, size, pos, "]]>");
+	if (startsWithSequence(data, size, pos, "<?"))
+		return skipPastSequence(data, size, pos, "?>");
+	if (startsWithSequence(data, size, pos, "<!"))
+		return skipPastSequence(data, size, pos, ">");
+
+	return pos;
 }
 
-bool AppConfigurationBase::create()
+static juce::String getTagName(const char* data, int size, int tagStart)
 {
-	if (exists())
-		return true;
+	auto nameEnd = tagStart + 1;
+	while (nameEnd < size && !juce::CharacterFunctions::isWhitespace(data[nameEnd]) && data[nameEnd] != '/' && data[nameEnd] != '>')
+		nameEnd++;
 
-	if (!m_file->create().wasOk())
-		return false;
-
-	return true;
+	return juce::String::fromUTF8(data + tagStart + 1, nameEnd - tagStart - 1);
 }
 
-bool AppConfigurationBase::initializeFromDisk()
+/**
+ * Indexes the top-level sections of an xml document without parsing them.
+ * Only the start tag of the root element is returned as an element, the text of each
+ * of the root's children is returned verbatim to be parsed on demand.
+ * @param data				The xml document data.
+ * @param size				The xml document data size in bytes.
+ * @param rootStartTag		Receives the root start tag text, as self-closing tag.
+ * @param sectionTagNames	Receives the tag names of the root's children.
+ * @param sectionTexts		Receives the verbatim text of the root's children.
+ * @return	True if the document could be indexed, false if it is not well-formed enough to do so.
+ */
+static bool indexTopLevelSections(const char* data, int size, juce::String& rootStartTag, juce::StringArray& sectionTagNames, juce::StringArray& sectionTexts)
 {
-	m_xml = juce::parseXML(*m_file.get());
+	auto pos = 0;
+	auto isSelfClosing = false;
 
-	if (m_xml && m_xml->hasTagName(juce::JUCEApplication::getInstance()->getApplicationName()))
-	{
-		if (UsesConfigVersion())
-		{
-			const juce::String cfgVAttributeName = "configVersion";
-			if (!m_xml->hasAttribute(cfgVAttributeName))
-			{
-				m_xml->setAttribute(cfgVAttributeName, m_configVersion.ToString());
-				return true;
-			}
-			else
-			{
-				auto configVersionFound = Version::FromString(m_xml->getStringAttribute(cfgVAttributeName));
-				if (configVersionFound != m_configVersion)
-					return HandleConfigVersionConflict(configVersionFound);
-			}
-		}
-		
-		return true;		
-	}
-	else
+	// skip the prolog to find the root start tag
+	while (true)
 	{
-		m_xml = std::make_unique<juce::XmlElement>(juce::JUCEApplication::getInstance()->getApplicationName());
+		while (pos < size && juce::CharacterFunctions::isWhitespace(data[pos]))
+			pos++;
+		if (pos >= size || data[pos] != '<')
+			return false;
+
+		auto markupEnd = skipNonElementMarkup(data, size, pos);
+		if (markupEnd < 0)
+			return false;
+		if (markupEnd == pos)
+			break;
+		pos = markupEnd;
 	}
-		
-	return false;
-}
 
-bool AppConfigurationBase::flush(bool includeWatcherUpdate)
-{
-	if (!m_xml)
+	auto rootStart = pos;
+	pos = skipTag(data, size, pos, isSelfClosing);
+	if (pos < 0)
 		return false;
 
-	if (GetFlushAndUpdateDisabled().first) // check if config flushing to disk is globally disabled
-	{
-#ifdef DEBUG
-		DBG(juce::String(__FUNCTION__) + " config flushing to disk is globally disabled");
-#endif
+	rootStartTag = juce::String::fromUTF8(data + rootStart, pos - rootStart);
+	if (!isSelfClosing)
+		rootStartTag = rootStartTag.dropLastCharacters(1) + "/>";
+	else
 		return true;
-	}
-
-//#ifdef DEBUG
-//	debugPrintXmlTree();
-//#endif
 
+	while (pos < size)
 	{
-		std::lock_guard<std::mutex> l(m_xmlCopyAccessMutex);
-		m_xmlFileFlushCopy = std::make_unique<juce::XmlElement>(*m_xml);
+		while (pos < size && juce::CharacterFunctions::isWhitespace(data[pos]))
+			pos++;
+		if (pos >= size || data[pos] != '<')
+			return false; // top-level text content is not supported
+		if (startsWithSequence(data, size, pos, "</"))
+			return true; // root end tag
+
+		auto markupEnd = skipNonElementMarkup(data, size, pos);
+		if (markupEnd < 0)
+			return false;
+		if (markupEnd != pos)
+		{
+			pos = markupEnd;
+			continue;
+		}
+
+		// a top-level section element, find its end by tracking the nesting depth
+		auto sectionStart = pos;
+		auto depth = 0;
+		do
+		{
+			pos = skipNonElementMarkup(data, size, pos);
+			if (pos < 0)
+				return false;
+			if (pos >= size || data[pos] != '<')
+			{
+				pos = skipPastSequence(data, size, pos, "<");
+				if (pos < 0)
+					return false;
+				pos--;
+				continue;
+			}
+
+			auto isEndTag = startsWithSequence(data, size, pos, "</");
+			pos = skipTag(data, size, pos, isSelfClosing);
+			if (pos < 0)
+				return false;
+
+			if (isEndTag)
+				depth--;
+			else if (!isSelfClosing)
+				depth++;
+		} while (depth > 0);
+
+		sectionTagNames.add(getTagName(data, size, sectionStart));
+		sectionTexts.add(juce::String::fromUTF8(data + sectionStart, pos - sectionStart));
 	}
-	m_fileFlushCV.notify_all();
 
-	if (includeWatcherUpdate)
-		triggerWatcherUpdate();
+	return false;
+}
 
-	return true;
+//==============================================================================
+/**
+ * Requests a configuration dump and flush. If this element is a Dumper itself,
+ * it is flagged as modified, to be included in the dump when using dirty tracking.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ */
+void AppConfigurationBase::XmlConfigurableElement::triggerConfigurationUpdate(bool includeWatcherUpdate)
+{
+	if (auto dumper = dynamic_cast<Dumper*>(this))
+		dumper->setConfigurationDirty();
+
+	auto config = AppConfigurationBase::getInstance();
+	if (config != nullptr)
+		config->triggerConfigurationDump(includeWatcherUpdate);
 }
 
-void AppConfigurationBase::addDumper(AppConfigurationBase::Dumper* d)
+/**
+ * Applies individual mutations of this element's state to the configuration in place and
+ * requests a configuration flush. Unlike triggerConfigurationUpdate, no dump is requested,
+ * since the state of this element is already up to date in the configuration.
+ * @param patch					The mutations to apply.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ */
+void AppConfigurationBase::XmlConfigurableElement::triggerConfigurationPatch(const ConfigPatch& patch, bool includeWatcherUpdate)
 {
-	m_dumpers.push_back(d);
+	auto config = AppConfigurationBase::getInstance();
+	if (config != nullptr && config->applyConfigPatch(patch))
+		config->triggerConfigurationFlush(includeWatcherUpdate);
 }
 
-void AppConfigurationBase::triggerConfigurationDump(bool includeWatcherUpdate)
+//==============================================================================
+AppConfigurationBase::AppConfigurationBase()
 {
+	if (m_singleton)
+		jassertfalse;
+	m_singleton = this;
+}
 
-	for (const auto& d : m_dumpers)
-		d->performConfigurationDump();
+AppConfigurationBase::~AppConfigurationBase()
+{
+	// A pending coalesced dump cannot be processed here any more, since the Dumpers
+	// might already be gone. Applications using a flush coalescing window are
+	// expected to call flushPendingConfigurationDump() on shutdown.
+	if (m_dumpPending)
+		DBG(juce::String(__FUNCTION__) + " discarding pending configuration dump");
+	m_dumpScheduler.reset();
 
-	flush(includeWatcherUpdate);
+	TeardownFileMonitorThread();
+	m_externalChangeApplier.reset();
+	m_sharedRegionMonitor.reset();
+
+	TeardownFileFlushThread();
+
+	// typed values outliving the configuration must not access it any more
+	{
+		std::lock_guard<std::mutex> typedvalueslock(m_typedValuesMutex);
+		for (auto typedValue : m_typedValues)
+			typedValue->m_config = nullptr;
+		m_typedValues.clear();
+		m_pendingTypedValueWriteBacks.clear();
+	}
+
+	if (m_singleton == this)
+		m_singleton = nullptr;
 }
 
-void AppConfigurationBase::clearDumpers()
+/**
+ * Initializes the configuration from the given file, creating it if it does not exist.
+ * @param file			The config file.
+ * @param configVersion	The config version expected to be found in the file.
+ * @param compressed	True to store the config file gzip compressed. Files are loaded regardless of
+ *						their compression, the configured format is applied with the next write.
+ */
+void AppConfigurationBase::InitializeBase(const juce::File& file, const Version& configVersion, bool compressed)
 {
-	m_dumpers.clear();
+	InitializeBase(std::make_unique<FileConfigurationStorage>(file.getParentDirectory()), file.getFileName(), configVersion, compressed);
 }
 
-void AppConfigurationBase::addWatcher(AppConfigurationBase::Watcher* w, bool initialUpdate)
+/**
+ * Initializes the configuration from the given storage backend, creating it if it does not exist.
+ * @param storage		The storage backend to keep the config and its auxiliary data in.
+ * @param configName	The name of the config in the storage backend. Auxiliary data is stored with names derived from it.
+ * @param configVersion	The config version expected to be found in the storage.
+ * @param compressed	True to store the config gzip compressed. Configs are loaded regardless of
+ *						their compression, the configured format is applied with the next write.
+ */
+void AppConfigurationBase::InitializeBase(std::unique_ptr<AppConfigurationStorage> storage, const juce::String& configName, const Version& configVersion, bool compressed)
 {
-	if (initialUpdate)
-		w->onConfigUpdated();
+	jassert(storage && configName.isNotEmpty());
 
-	m_watchers.push_back(w);
-}
+	m_storage = std::move(storage);
+	m_configName = configName;
+	auto file = m_storage->getFile(m_configName);
+	m_file = file != juce::File() ? std::make_unique<juce::File>(file) : nullptr;
+	m_configVersion = configVersion;
+	m_compressedStorage = compressed;
 
-void AppConfigurationBase::triggerWatcherUpdate()
-{
-	if (GetFlushAndUpdateDisabled().second) // check if watcher updating is globally disabled
+	if (!m_storage->recoverInterruptedWrite(m_configName))
+		jassertfalse;
+
+	if (!exists() && !create())
+		jassertfalse;
+
+	if (!initializeFromDisk())
+		jassertfalse;
+
+	publishConfigSnapshot(true);
+
+	// the initial flush is only required if loading changed the configuration or a file is missing
+	if (m_loadedStateMatchesDisk && m_lastBuiltSnapshot)
 	{
-#ifdef DEBUG
-		DBG(juce::String(__FUNCTION__) + " config watcher updating is globally disabled");
-#endif
-		return;
+		m_lastFlushedHash = m_lastBuiltSnapshot->getHash();
+		if (m_shardedStorageEnabled)
+		{
+			m_lastFlushedShardHashes = getShardHashes(*m_lastBuiltSnapshot);
+			m_lastFlushedShardRootHash = m_lastBuiltSnapshot->m_rootAttributesHash;
+		}
 	}
 
-	for (const auto& w : m_watchers)
-		w->onConfigUpdated();
+	SetupSharedRegion();
+
+	if (!flush(false))
+		jassertfalse;
+
+	SetupFileFlushThread();
+
+	if (m_externalChangeMonitoringEnabled)
+		SetupFileMonitorThread();
 }
 
-void AppConfigurationBase::clearWatchers()
+AppConfigurationStorage* AppConfigurationBase::getStorage() const
 {
-	m_watchers.clear();
+	return m_storage.get();
 }
 
-std::unique_ptr<juce::XmlElement> AppConfigurationBase::getConfigState(juce::StringRef tagName)
+const juce::String& AppConfigurationBase::getConfigName() const
 {
-	if (m_xml)
-	{
-		if (tagName.isEmpty())
-			return std::make_unique<juce::XmlElement>(*m_xml);
-
-		juce::XmlElement *tagNameElement = m_xml->getChildByName(tagName);
-		if (tagNameElement)
-			return std::make_unique<juce::XmlElement>(*tagNameElement);
-		else
-			return nullptr;
-	}
-	else
-		return nullptr;
+	return m_configName;
 }
 
-bool AppConfigurationBase::setConfigState(std::unique_ptr<juce::XmlElement> stateXml, juce::StringRef attributeName)
+void AppConfigurationBase::SetupFileFlushThread()
 {
-	if (stateXml && m_xml)
-	{
-		juce::XmlElement *existingChildElement = m_xml->getChildByName(stateXml->getTagName());
-		juce::XmlElement* childElement = existingChildElement;
-		while (childElement != nullptr && attributeName.isNotEmpty())
+	m_fileFlushThreadActive.store(true);
+	m_fileFlushThread = std::make_unique<std::thread>([this]()
 		{
-			if (childElement->getIntAttribute(attributeName) == stateXml->getIntAttribute(attributeName))
+			std::unique_lock<std::mutex> fileflushlock(m_fileFlushCVMutex);
+			while (true)
 			{
-				existingChildElement = childElement;
-				break;
-			}
+				// waiting on the generations instead of the bare notification makes sure that
+				// a flush requested while the previous one is being written is not lost
+				m_fileFlushCV.wait(fileflushlock, [this]() { return !m_fileFlushThreadActive.load() || m_flushRequestedGeneration > m_flushWrittenGeneration; });
+				if (m_flushRequestedGeneration <= m_flushWrittenGeneration)
+					break; // teardown, with all requested flushes written
 
-			childElement = childElement->getNextElementWithTagName(stateXml->getTagName());
-		}
+				// all flush copies up to this generation were handed over before it was requested
+				auto flushGeneration = m_flushRequestedGeneration;
+				auto flushQueueLatencyUs = juce::int64((juce::Time::getMillisecondCounterHiRes() - m_oldestPendingFlushRequestTimeMs) * 1000.0);
+				fileflushlock.unlock();
 
-		if(!existingChildElement || existingChildElement->getIntAttribute(attributeName) != stateXml->getIntAttribute(attributeName))
-			m_xml->addChildElement(std::make_unique<juce::XmlElement>(*stateXml).release());
-		else
-			m_xml->replaceChildElement(existingChildElement, new juce::XmlElement(*stateXml));
+				{
+					std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+					m_metrics.flushQueueLatencyUs.add(flushQueueLatencyUs);
+				}
 
-		return true;
-	}
-		
-	return false;
+				auto success = writePendingFlush();
+				if (!success)
+					m_lastFlushWriteFailed.store(true);
+				fileflushlock.lock();
+
+				m_flushWrittenGeneration = flushGeneration;
+				for (auto completion = m_flushCompletions.begin(); completion != m_flushCompletions.end();)
+				{
+					if (completion->first > flushGeneration)
+						++completion;
+					else
+					{
+						completion->second.set_value(success);
+						completion = m_flushCompletions.erase(completion);
+					}
+				}
+			}
+
+			for (auto& completion : m_flushCompletions)
+				completion.second.set_value(false);
+			m_flushCompletions.clear();
+		});
 }
 
-bool AppConfigurationBase::resetConfigState(std::unique_ptr<juce::XmlElement> fullStateXml)
+/**
+ * Writes the flush copy handed over by flush() to disk, or appends the queued deltas to the
+ * delta journal, compacting it if it grew too large. Called on the flush thread.
+ * @return	True if the pending changes were written successfully.
+ */
+bool AppConfigurationBase::writePendingFlush()
 {
-	m_xml.reset(fullStateXml.release());
+	auto success = true;
 
-	triggerWatcherUpdate();
+	// Only taking over what flush() handed over is done under the lock, serializing and
+	// writing it is not, to not block a flush() requested meanwhile for the duration of the write.
+	std::shared_ptr<const ConfigSnapshot> snapshotFlushCopy;
+	std::vector<DeltaRecord> deltaFlushQueue;
+	std::map<juce::String, std::vector<std::shared_ptr<const juce::XmlElement>>> shardFlushQueue;
+	std::unique_ptr<juce::XmlElement> shardRootFlushCopy;
+	juce::String shardRootTagName;
+	{
+		std::lock_guard<std::mutex> xmlaccesslock(m_xmlCopyAccessMutex);
+		snapshotFlushCopy = std::move(m_snapshotFlushCopy);
+		deltaFlushQueue.swap(m_deltaFlushQueue);
+		shardFlushQueue.swap(m_shardFlushQueue);
+		shardRootFlushCopy = std::move(m_shardRootFlushCopy);
+		shardRootTagName = m_shardRootTagName;
+	}
 
-	return true;
-}
+	if (snapshotFlushCopy)
+	{
+		std::vector<const juce::XmlElement*> sectionXmls;
+		auto hasUnparsedSections = false;
+		for (auto const& section : snapshotFlushCopy->m_sections)
+		{
+			if (auto sectionXml = section.getParsedXml())
+				sectionXmls.push_back(sectionXml);
+			else
+				hasUnparsedSections = true;
+		}
 
-bool AppConfigurationBase::flushToDisk()
-{
-	return flush(false);
+		if (!writeToDisk(*snapshotFlushCopy))
+		{
+			jassertfalse;
+			success = false;
+		}
+		else if (IsBinarySnapshotEnabled() && !hasUnparsedSections && !writeBinarySnapshot(*snapshotFlushCopy->m_root, sectionXmls))
+			jassertfalse;
+
+		// the full write contains all previously journaled deltas and shards
+		if (!m_storage->remove(getAuxiliaryName(".delta")))
+			jassertfalse;
+		for (auto const& shardName : m_storage->getNames(getShardPrefix()))
+			if (!m_storage->remove(shardName))
+				jassertfalse;
+
+		// Only compaction of the delta journal requires a mutable copy of what is on disk.
+		// It is created here on the flush thread, instead of by the thread requesting the flush.
+		if (m_persistenceMode == PM_DeltaJournal)
+		{
+			auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+			m_deltaJournalBaseXml = std::make_unique<juce::XmlElement>(*snapshotFlushCopy->m_root);
+			m_deltaJournalBaseUnparsedSections.clear();
+			for (auto const& section : snapshotFlushCopy->m_sections)
+			{
+				if (auto sectionXml = section.getParsedXml())
+					m_deltaJournalBaseXml->addChildElement(new juce::XmlElement(*sectionXml));
+				else
+					m_deltaJournalBaseUnparsedSections.push_back({ section.tagName, section.unparsedText });
+			}
+			auto deepCopyTimeUs = juce::int64((juce::Time::getMillisecondCounterHiRes() - startTimeMs) * 1000.0);
+			{
+				std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+				m_metrics.deepCopyTimeUs.add(deepCopyTimeUs);
+			}
+		}
+	}
+
+	if (!deltaFlushQueue.empty())
+	{
+		if (!appendToDeltaJournal(deltaFlushQueue))
+		{
+			jassertfalse;
+			success = false;
+		}
+
+		// Background compaction: the deltas are folded into the copy of what is on disk,
+		// which is written as new full snapshot as soon as the journal grows too large.
+		if (m_deltaJournalBaseXml)
+		{
+			for (auto const& delta : deltaFlushQueue)
+			{
+				if (delta.patch)
+				{
+					// patches are applied in place, the base does not need to be copied for them
+					parseUnparsedSections(*m_deltaJournalBaseXml, m_deltaJournalBaseUnparsedSections, delta.patch->getSectionTagName());
+					auto effect = ConfigPatchEffect();
+					applyConfigPatchOperations(*findConfigPatchTarget(*m_deltaJournalBaseXml, *delta.patch), *delta.patch, effect);
+				}
+				else
+				{
+					parseUnparsedSections(*m_deltaJournalBaseXml, m_deltaJournalBaseUnparsedSections, delta.stateXml->getTagName());
+					mergeConfigState(*m_deltaJournalBaseXml, *delta.stateXml, delta.keyAttributeName);
+				}
+			}
+
+			auto deltaJournalName = getAuxiliaryName(".delta");
+			if (m_storage->getSize(deltaJournalName) > m_deltaJournalCompactionThreshold)
+			{
+				if (!writeToDisk(*m_deltaJournalBaseXml, m_deltaJournalBaseUnparsedSections) || !m_storage->remove(deltaJournalName))
+					jassertfalse;
+				else if (IsBinarySnapshotEnabled() && m_deltaJournalBaseUnparsedSections.empty())
+				{
+					std::vector<const juce::XmlElement*> sectionXmls;
+					for (auto childElement : m_deltaJournalBaseXml->getChildIterator())
+						sectionXmls.push_back(childElement);
+					if (!writeBinarySnapshot(*m_deltaJournalBaseXml, sectionXmls))
+						jassertfalse;
+				}
+			}
+		}
+		else
+			jassertfalse; // deltas are expected to be based on a previous full write
+	}
+
+	if (!shardFlushQueue.empty() || shardRootFlushCopy)
+	{
+		for (auto const& shard : shardFlushQueue)
+		{
+			auto shardName = getShardName(shard.first);
+			if (shard.second.empty() ? !m_storage->remove(shardName) : !writeShard(shardName, shardRootTagName, shard.second))
+			{
+				jassertfalse;
+				success = false;
+			}
+		}
+
+		// The root file is written after the shards, since shards newer than a root file
+		// that still contains their sections take precedence when loading (see loadShards).
+		if (shardRootFlushCopy)
+		{
+			if (!writeToDisk(*shardRootFlushCopy, {}))
+			{
+				jassertfalse;
+				success = false;
+			}
+
+			for (auto const& obsoleteSuffix : { ".delta", ".bin" })
+				if (!m_storage->remove(getAuxiliaryName(obsoleteSuffix)))
+					jassertfalse;
+		}
+	}
+
+	return success;
+}
+
+void AppConfigurationBase::TeardownFileFlushThread()
+{
+	{
+		std::lock_guard<std::mutex> fileflushlock(m_fileFlushCVMutex);
+		m_fileFlushThreadActive.store(false);
+	}
+	m_fileFlushCV.notify_all();
+	if (m_fileFlushThread)
+		m_fileFlushThread->join();
+}
+
+void AppConfigurationBase::SetupFileMonitorThread()
+{
+	if (m_shardedStorageEnabled)
+	{
+		DBG(juce::String(__FUNCTION__) + " monitoring external changes is not supported for sharded storage");
+		return;
+	}
+	if (!m_file)
+	{
+		DBG(juce::String(__FUNCTION__) + " monitoring external changes requires a storage backend that keeps the config as file");
+		return;
+	}
+
+	if (!m_externalChangeApplier)
+		m_externalChangeApplier = std::make_unique<ExternalChangeApplier>(*this);
+
+	// the current file content is the baseline that changes are detected against
+	juce::MemoryBlock fileData;
+	m_lastObservedFileHash = m_file->loadFileAsData(fileData) ? hashBytes(s_fnvOffsetBasis, fileData.getData(), fileData.getSize()) : 0;
+
+	m_fileMonitorThreadActive.store(true);
+	m_fileMonitorThread = std::make_unique<std::thread>([this]()
+		{
+			auto lastModificationTime = m_file->getLastModificationTime();
+			auto lastSize = m_file->getSize();
+
+#if JUCE_LINUX
+			// The directory is watched instead of the file, since the file is replaced on every write,
+			// which would silently end a watch on the file itself.
+			auto inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			auto watchDescriptor = inotifyFd >= 0
+				? inotify_add_watch(inotifyFd, m_file->getParentDirectory().getFullPathName().toRawUTF8(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+				: -1;
+			if (watchDescriptor < 0)
+				DBG(juce::String(__FUNCTION__) + " unable to watch " + m_file->getParentDirectory().getFullPathName() + ", polling instead");
+
+			while (watchDescriptor >= 0 && m_fileMonitorThreadActive.load())
+			{
+				// the timeout only bounds the time until a teardown is noticed
+				pollfd inotifyPollFd{ inotifyFd, POLLIN, 0 };
+				if (poll(&inotifyPollFd, 1, 250) <= 0)
+					continue;
+
+				auto configFileChanged = false;
+				alignas(inotify_event) char eventBuffer[4096];
+				auto length = ssize_t(0);
+				while ((length = read(inotifyFd, eventBuffer, sizeof(eventBuffer))) > 0)
+				{
+					for (auto eventPosition = eventBuffer; eventPosition < eventBuffer + length;)
+					{
+						auto event = reinterpret_cast<const inotify_event*>(eventPosition);
+						if (event->len > 0 && m_file->getFileName() == juce::String::fromUTF8(event->name))
+							configFileChanged = true;
+						eventPosition += sizeof(inotify_event) + event->len;
+					}
+				}
+
+				if (configFileChanged)
+					checkExternalConfigChange();
+			}
+
+			if (inotifyFd >= 0)
+				close(inotifyFd);
+			if (watchDescriptor >= 0)
+				return;
+#endif
+
+			std::unique_lock<std::mutex> filemonitorlock(m_fileMonitorCVMutex);
+			while (m_fileMonitorThreadActive.load())
+			{
+				m_fileMonitorCV.wait_for(filemonitorlock, std::chrono::milliseconds(m_fileMonitorPollIntervalMs), [this]() { return !m_fileMonitorThreadActive.load(); });
+				if (!m_fileMonitorThreadActive.load())
+					break;
+
+				auto modificationTime = m_file->getLastModificationTime();
+				auto size = m_file->getSize();
+				if (modificationTime == lastModificationTime && size == lastSize)
+					continue;
+
+				lastModificationTime = modificationTime;
+				lastSize = size;
+				checkExternalConfigChange();
+			}
+		});
+}
+
+void AppConfigurationBase::TeardownFileMonitorThread()
+{
+	{
+		std::lock_guard<std::mutex> filemonitorlock(m_fileMonitorCVMutex);
+		m_fileMonitorThreadActive.store(false);
+	}
+	m_fileMonitorCV.notify_all();
+	if (m_fileMonitorThread)
+		m_fileMonitorThread->join();
+	m_fileMonitorThread.reset();
+
+	if (m_externalChangeApplier)
+		m_externalChangeApplier->cancelPendingUpdate();
+}
+
+/**
+ * Remembers the hash of a config file written by this process, to not mistake it for an external change.
+ * A few hashes are kept, since the monitor thread may observe a file after subsequent writes were started.
+ * @param fileHash	The hash of the written file's bytes.
+ */
+void AppConfigurationBase::recordOwnWrite(juce::uint64 fileHash)
+{
+	std::lock_guard<std::mutex> ownwriteslock(m_ownWriteHashesMutex);
+	m_recentOwnWriteHashes.push_back(fileHash);
+	if (m_recentOwnWriteHashes.size() > 8)
+		m_recentOwnWriteHashes.erase(m_recentOwnWriteHashes.begin());
+}
+
+/**
+ * Reads the config file after it was found changed and, if its content was not written by this process,
+ * parses and hashes it in the background. The result is handed over to the message thread to be applied.
+ * Called on the monitor thread.
+ */
+void AppConfigurationBase::checkExternalConfigChange()
+{
+	juce::MemoryBlock configData;
+	if (!m_file->loadFileAsData(configData))
+		return;
+
+	auto fileHash = hashBytes(s_fnvOffsetBasis, configData.getData(), configData.getSize());
+	if (fileHash == m_lastObservedFileHash)
+		return;
+	m_lastObservedFileHash = fileHash;
+	{
+		std::lock_guard<std::mutex> ownwriteslock(m_ownWriteHashesMutex);
+		if (std::find(m_recentOwnWriteHashes.begin(), m_recentOwnWriteHashes.end(), fileHash) != m_recentOwnWriteHashes.end())
+			return;
+	}
+
+	decompressConfigData(configData);
+	auto externalXml = juce::parseXML(juce::String::fromUTF8(static_cast<const char*>(configData.getData()), int(configData.getSize())));
+	if (!externalXml)
+	{
+		// most likely an editor is still writing the file, the next change notification will pick up its final content
+		DBG(juce::String(__FUNCTION__) + " unable to parse externally changed " + m_file->getFullPathName());
+		return;
+	}
+
+	std::vector<std::shared_ptr<const ConfigSnapshot::SectionHashes>> sectionHashes;
+	for (auto childElement : externalXml->getChildIterator())
+	{
+		auto hashes = std::make_shared<ConfigSnapshot::SectionHashes>();
+		hashes->hash = hashXml(*childElement, &hashes->attributesHash, &hashes->childHashes);
+		sectionHashes.push_back(std::move(hashes));
+	}
+
+	{
+		std::lock_guard<std::mutex> externalchangelock(m_externalChangeMutex);
+		m_externalConfigXml = std::move(externalXml);
+		m_externalConfigSectionHashes = std::move(sectionHashes);
+	}
+	m_externalChangeApplier->triggerAsyncUpdate();
+}
+
+/**
+ * Applies the externally changed configuration handed over by the monitor thread. If the root element
+ * and the section structure are unchanged, only the sections whose hashes differ are replaced in m_xml,
+ * otherwise the whole configuration is reset. Watchers are notified of the changed paths only.
+ * Called on the message thread.
+ */
+void AppConfigurationBase::applyExternalConfigChange()
+{
+	std::unique_ptr<juce::XmlElement> externalXml;
+	std::vector<std::shared_ptr<const ConfigSnapshot::SectionHashes>> externalSectionHashes;
+	{
+		std::lock_guard<std::mutex> externalchangelock(m_externalChangeMutex);
+		externalXml = std::move(m_externalConfigXml);
+		externalSectionHashes = std::move(m_externalConfigSectionHashes);
+	}
+
+	if (!externalXml || !m_xml)
+		return;
+	if (!externalXml->hasTagName(getRootTagName()))
+	{
+		DBG(juce::String(__FUNCTION__) + " ignoring externally changed " + m_file->getFullPathName() + " with unexpected root element " + externalXml->getTagName());
+		return;
+	}
+
+	ensureConfigSectionParsed();
+
+	auto previousSnapshot = buildConfigSnapshot();
+	auto unchangedSinceFlush = previousSnapshot->getHash() == m_lastFlushedHash && m_pendingDeltas.empty();
+
+	// sections are matched by tag name and order of occurrence, like in collectSnapshotChanges
+	std::map<juce::String, std::vector<juce::XmlElement*>> liveSectionsByTagName;
+	for (auto childElement : m_xml->getChildIterator())
+		liveSectionsByTagName[childElement->getTagName()].push_back(childElement);
+	std::map<juce::String, std::vector<juce::XmlElement*>> externalSectionsByTagName;
+	for (auto childElement : externalXml->getChildIterator())
+		externalSectionsByTagName[childElement->getTagName()].push_back(childElement);
+
+	auto structureChanged = hashAttributes(*externalXml) != previousSnapshot->m_rootAttributesHash
+		|| externalSectionHashes.size() != size_t(externalXml->getNumChildElements());
+	for (auto liveSections = liveSectionsByTagName.begin(); liveSections != liveSectionsByTagName.end() && !structureChanged; ++liveSections)
+		structureChanged = externalSectionsByTagName[liveSections->first].size() != liveSections->second.size();
+	for (auto externalSections = externalSectionsByTagName.begin(); externalSections != externalSectionsByTagName.end() && !structureChanged; ++externalSections)
+		structureChanged = liveSectionsByTagName[externalSections->first].size() != externalSections->second.size();
+
+	if (structureChanged)
+	{
+		resetConfigState(std::move(externalXml));
+	}
+	else
+	{
+		std::unordered_map<const juce::XmlElement*, const ConfigSnapshot::Section*> previousSections;
+		for (auto const& section : previousSnapshot->m_sections)
+			previousSections[section.liveElement] = &section;
+
+		std::vector<std::pair<juce::XmlElement*, size_t>> externalSections;
+		auto externalSectionIndex = size_t(0);
+		for (auto childElement : externalXml->getChildIterator())
+			externalSections.push_back(std::make_pair(childElement, externalSectionIndex++));
+
+		auto changes = ConfigChangeSet();
+		std::map<juce::String, size_t> sectionOccurrences;
+		for (auto const& externalSection : externalSections)
+		{
+			auto tagName = externalSection.first->getTagName();
+			auto liveElement = liveSectionsByTagName[tagName][sectionOccurrences[tagName]++];
+			auto previousSection = previousSections[liveElement];
+			auto const& hashes = externalSectionHashes[externalSection.second];
+			if (previousSection->hashes->hash == hashes->hash)
+				continue;
+
+			collectChangedPaths(previousSection->getParsedXml(), *externalSection.first, changes, previousSection->hashes.get(), hashes.get());
+
+			externalXml->removeChildElement(externalSection.first, false);
+			m_xml->replaceChildElement(liveElement, externalSection.first);
+			stageConfigSnapshotSection(externalSection.first);
+			invalidateConfigStateIndex(tagName);
+		}
+
+		if (changes.isEmpty())
+			return; // e.g. only the formatting of the file changed
+
+		// journaled deltas cannot express replaced sections that are not identified by a key attribute
+		if (m_persistenceMode == PM_DeltaJournal)
+			m_fullWriteRequired = true;
+
+		publishConfigSnapshot();
+
+		addPendingConfigChanges(changes);
+
+		triggerWatcherUpdate();
+	}
+
+	// the applied state is what is on disk already and does not need to be written again
+	if (unchangedSinceFlush && m_lastBuiltSnapshot)
+		m_lastFlushedHash = m_lastBuiltSnapshot->getHash();
+}
+
+/**
+ * Opens the shared region for the configured shared sections and starts polling it for changes
+ * of other instances. A region written after the config was last stored holds changes of an
+ * instance that is still running and is adopted. A stale region, e.g. left by a previous session,
+ * is overwritten with the loaded state instead.
+ */
+void AppConfigurationBase::SetupSharedRegion()
+{
+	if (m_sharedSectionTagNames.isEmpty())
+		return;
+
+	for (auto const& tagName : m_sharedSectionTagNames)
+		ensureConfigSectionParsed(tagName);
+
+	// instances using the same config share a region
+	auto regionName = getRootTagName() + "_" + juce::String::toHexString(juce::int64(hashString(s_fnvOffsetBasis, m_storage->getDisplayName(m_configName))));
+	m_sharedRegion = std::make_unique<SharedConfigurationRegion>(regionName, m_sharedRegionCapacity);
+	if (!m_sharedRegion->isValid())
+	{
+		DBG(juce::String(__FUNCTION__) + " unable to open shared region " + regionName + ", shared sections are not synchronized");
+		m_sharedRegion.reset();
+		return;
+	}
+
+	auto regionSequence = m_sharedRegion->getSequence();
+	auto regionIsNewer = regionSequence != 0 && (!m_file || m_sharedRegion->getWriteTime() >= m_storage->getModificationTime(m_configName));
+	if (regionIsNewer)
+		pollSharedRegion();
+	else
+		m_sharedRegionSequence = regionSequence; // the next flush publishes the loaded shared sections
+
+	m_sharedRegionMonitor = std::make_unique<SharedRegionMonitor>(*this);
+	m_sharedRegionMonitor->startTimer(m_sharedRegionPollIntervalMs);
+}
+
+/**
+ * Writes the shared sections of the last published snapshot to the shared region, if they changed
+ * since they were last published or applied. Concurrent changes of the same sections by several
+ * instances are resolved by the last write. Called on the message thread.
+ * @return	True if the region is up to date, false if it could not be written.
+ */
+bool AppConfigurationBase::publishSharedSections()
+{
+	if (!m_sharedRegion || !m_lastBuiltSnapshot)
+		return true;
+
+	auto hash = getSharedSectionsHash(*m_lastBuiltSnapshot);
+	if (hash == m_sharedSectionsHash)
+		return true;
+
+	juce::MemoryOutputStream sharedStream;
+	sharedStream << "<SharedSections>";
+	for (auto const& section : m_lastBuiltSnapshot->m_sections)
+		if (m_sharedSectionTagNames.contains(section.tagName))
+			if (auto sectionXml = section.getXml())
+				sectionXml->writeTo(sharedStream, juce::XmlElement::TextFormat().singleLine().withoutHeader());
+	sharedStream << "</SharedSections>";
+
+	auto sequence = juce::uint64(0);
+	if (!m_sharedRegion->write(sharedStream.getData(), sharedStream.getDataSize(), 100, sequence))
+		return false;
+
+	m_sharedRegionSequence = sequence;
+	m_sharedSectionsHash = hash;
+
+	return true;
+}
+
+/**
+ * Checks the shared region for a write of another instance and applies it. Only the sequence number
+ * is read unless it changed, the region's content is then parsed, but not the config itself.
+ * Shared sections whose publishing failed before are published again. Called on the message thread.
+ */
+void AppConfigurationBase::pollSharedRegion()
+{
+	// applying changes of other instances is deferred until the outermost transaction is committed
+	if (!m_sharedRegion || !m_xml || isInTransaction())
+		return;
+
+	auto sequence = m_sharedRegion->getSequence();
+	if (sequence != m_sharedRegionSequence && (sequence & 1) == 0)
+	{
+		juce::MemoryBlock sharedData;
+		if (!m_sharedRegion->read(sharedData, sequence))
+			return; // retried with the next poll
+
+		m_sharedRegionSequence = sequence;
+
+		auto sharedXml = juce::parseXML(juce::String::fromUTF8(static_cast<const char*>(sharedData.getData()), int(sharedData.getSize())));
+		if (!sharedXml)
+		{
+			DBG(juce::String(__FUNCTION__) + " unable to parse shared sections");
+			return;
+		}
+
+		applySharedSections(*sharedXml);
+		if (m_lastBuiltSnapshot)
+			m_sharedSectionsHash = getSharedSectionsHash(*m_lastBuiltSnapshot);
+	}
+	else if (!publishSharedSections())
+		DBG(juce::String(__FUNCTION__) + " unable to publish shared sections");
+}
+
+/**
+ * Applies the shared sections written by another instance. Sections are matched by tag name
+ * and order of occurrence, only sections that differ are replaced, added or removed, and the
+ * affected watchers are notified. Called on the message thread.
+ * @param sharedXml	The shared sections, as read from the shared region.
+ * @return	True on success.
+ */
+bool AppConfigurationBase::applySharedSections(const juce::XmlElement& sharedXml)
+{
+	for (auto const& tagName : m_sharedSectionTagNames)
+		ensureConfigSectionParsed(tagName);
+
+	auto previousSnapshot = buildConfigSnapshot();
+	if (!previousSnapshot)
+		return false;
+	auto unchangedSinceFlush = previousSnapshot->getHash() == m_lastFlushedHash && m_pendingDeltas.empty();
+
+	std::map<juce::String, std::vector<juce::XmlElement*>> liveSectionsByTagName;
+	for (auto childElement : m_xml->getChildIterator())
+		if (m_sharedSectionTagNames.contains(childElement->getTagName()))
+			liveSectionsByTagName[childElement->getTagName()].push_back(childElement);
+	std::unordered_map<const juce::XmlElement*, const ConfigSnapshot::Section*> previousSections;
+	for (auto const& section : previousSnapshot->m_sections)
+		previousSections[section.liveElement] = &section;
+
+	std::map<juce::String, size_t> sectionOccurrences;
+	for (auto sharedSectionXml : sharedXml.getChildIterator())
+	{
+		auto tagName = sharedSectionXml->getTagName();
+		if (!m_sharedSectionTagNames.contains(tagName))
+			continue;
+
+		auto const& liveSections = liveSectionsByTagName[tagName];
+		auto occurrence = sectionOccurrences[tagName]++;
+		auto liveElement = occurrence < liveSections.size() ? liveSections[occurrence] : nullptr;
+		if (liveElement != nullptr && previousSections[liveElement]->hashes->hash == hashXml(*sharedSectionXml))
+			continue;
+
+		auto sectionElement = new juce::XmlElement(*sharedSectionXml);
+		if (liveElement != nullptr)
+			m_xml->replaceChildElement(liveElement, sectionElement);
+		else
+			m_xml->addChildElement(sectionElement);
+		stageConfigSnapshotSection(sectionElement);
+		invalidateConfigStateIndex(tagName);
+	}
+
+	// shared sections that were removed by the other instance
+	for (auto const& liveSections : liveSectionsByTagName)
+	{
+		for (auto i = sectionOccurrences[liveSections.first]; i < liveSections.second.size(); ++i)
+		{
+			m_xml->removeChildElement(liveSections.second[i], true);
+			invalidateConfigStateIndex(liveSections.first);
+			m_snapshotPublishRequired = true;
+		}
+	}
+
+	auto changes = ConfigChangeSet();
+	collectSnapshotChanges(*previousSnapshot, *buildConfigSnapshot(), changes);
+	if (changes.isEmpty())
+		return true;
+
+	// journaled deltas cannot express replaced sections that are not identified by a key attribute
+	if (m_persistenceMode == PM_DeltaJournal)
+		m_fullWriteRequired = true;
+
+	publishConfigSnapshot();
+
+	addPendingConfigChanges(changes);
+
+	triggerWatcherUpdate();
+
+	// the writing instance stores the change, it does not need to be written again
+	if (unchangedSinceFlush && m_lastBuiltSnapshot)
+		m_lastFlushedHash = m_lastBuiltSnapshot->getHash();
+
+	return true;
+}
+
+/**
+ * Calculates a hash over the shared sections of a snapshot, from their section hashes.
+ * @param snapshot	The snapshot to hash the shared sections of.
+ * @return	The hash of the shared sections.
+ */
+juce::uint64 AppConfigurationBase::getSharedSectionsHash(const ConfigSnapshot& snapshot) const
+{
+	auto hash = s_fnvOffsetBasis;
+	for (auto const& section : snapshot.m_sections)
+		if (m_sharedSectionTagNames.contains(section.tagName))
+			hash = hashValue(hashString(hash, section.tagName), section.hashes->hash);
+
+	return hash;
+}
+
+AppConfigurationBase* AppConfigurationBase::getInstance() noexcept
+{
+	if (m_singleton == nullptr)
+	{
+		DBG("The configuration object was not yet created! Please make shure to do so in your derived class!");
+		jassertfalse;
+	}
+
+	return m_singleton;
+}
+
+juce::String AppConfigurationBase::getDefaultConfigFilePath() noexcept
+{
+	static juce::String s_configPath{ juce::File::getSpecialLocation(juce::File::SpecialLocationType::userApplicationDataDirectory).getFullPathName() + "/"
+										+ juce::JUCEApplication::getInstance()->getApplicationName() + "/"
+										+ juce::JUCEApplication::getInstance()->getApplicationName() + ".config" };
+
+	return s_configPath;
+}
+
+bool AppConfigurationBase::isValid()
+{
+	return isValid(m_xml);
+}
+
+bool AppConfigurationBase::isValid(const std::unique_ptr<juce::XmlElement>& xmlConfiguration)
+{
+	if (!xmlConfiguration)
+		return false;
+
+	auto rootTagName = m_singleton != nullptr ? m_singleton->getRootTagName() : juce::JUCEApplication::getInstance()->getApplicationName();
+	if (!xmlConfiguration->hasTagName(rootTagName))
+		return false;
+
+	return true;
+}
+
+/**
+ * Provides the tag name of the configuration's root element. Defaults to the application name,
+ * derived classes used without a JUCEApplication instance, e.g. in console tools, must reimplement this.
+ * @return	The root tag name.
+ */
+juce::String AppConfigurationBase::getRootTagName() const
+{
+	return juce::JUCEApplication::getInstance()->getApplicationName();
+}
+
+bool AppConfigurationBase::exists()
+{
+	return m_storage->exists(m_configName);
+}
+
+bool AppConfigurationBase::create()
+{
+	if (exists())
+		return true;
+
+	if (!m_storage->writeAtomically(m_configName, [](juce::OutputStream&) {}))
+		return false;
+
+	return true;
+}
+
+/**
+ * Writes the given xml to the config file in a crash-safe way, see writeConfigFile.
+ * @param xml				The xml tree to write.
+ * @param unparsedSections	The sections that were not parsed yet in lazy parsing mode, written verbatim.
+ * @return	True on success, false if any of the steps failed.
+ */
+bool AppConfigurationBase::writeToDisk(const juce::XmlElement& xml, const std::vector<UnparsedSection>& unparsedSections)
+{
+	return writeConfigFile([&](juce::OutputStream& stream) { writeConfigXml(stream, xml, unparsedSections); });
+}
+
+/**
+ * Writes the given snapshot to the config file in a crash-safe way, see writeConfigFile.
+ * The snapshot is serialized section by section, straight into the file stream.
+ * @param snapshot	The immutable snapshot to write.
+ * @return	True on success, false if any of the steps failed.
+ */
+bool AppConfigurationBase::writeToDisk(const ConfigSnapshot& snapshot)
+{
+	return writeConfigFile([&](juce::OutputStream& stream) { writeConfigSnapshot(stream, snapshot); });
+}
+
+/**
+ * Writes the config to the storage backend in a crash-safe way, see AppConfigurationStorage::writeAtomically.
+ * The written bytes are hashed on the fly, to be able to tell own writes from external changes.
+ * @param writeConfig	Writes the config content to the given stream.
+ * @return	True on success, false if any of the steps failed.
+ */
+bool AppConfigurationBase::writeConfigFile(const std::function<void(juce::OutputStream&)>& writeConfig)
+{
+	auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+	auto bytes = juce::int64(0);
+
+	auto success = m_storage->writeAtomically(m_configName, [&](juce::OutputStream& stream) {
+		auto startPosition = stream.getPosition();
+		HashingOutputStream hashingStream(stream);
+		if (m_compressedStorage)
+		{
+			juce::GZIPCompressorOutputStream compressorStream(hashingStream, 6, juce::GZIPCompressorOutputStream::windowBitsGZIP);
+			writeConfig(compressorStream);
+			compressorStream.flush();
+		}
+		else
+			writeConfig(hashingStream);
+		bytes = stream.getPosition() - startPosition;
+
+		// recorded before the config is replaced, so the monitor thread never observes it as external change
+		recordOwnWrite(hashingStream.getHash());
+	});
+	recordDiskWrite(success, true, bytes, startTimeMs);
+
+	return success;
+}
+
+/**
+ * Appends the given delta records to the delta journal in the storage backend. Each record is stored
+ * as its xml text, prefixed by a line containing the text length, which allows detecting a torn last
+ * record on replay. Section states are stored as Delta records, patches as Patch records.
+ * @param deltas	The delta records to append.
+ * @return	True on success, false if writing failed.
+ */
+bool AppConfigurationBase::appendToDeltaJournal(const std::vector<DeltaRecord>& deltas)
+{
+	auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+
+	juce::MemoryOutputStream deltaJournalStream;
+
+	auto format = juce::XmlElement::TextFormat().singleLine().withoutHeader();
+	for (auto const& delta : deltas)
+	{
+		auto deltaText = juce::String();
+		if (delta.patch)
+			deltaText = createConfigPatchXml(*delta.patch)->toString(format);
+		else
+		{
+			deltaText = "<Delta";
+			if (delta.keyAttributeName.isNotEmpty())
+				deltaText << " key=\"" << delta.keyAttributeName << "\"";
+			deltaText << ">" << delta.stateXml->toString(format) << "</Delta>";
+		}
+		deltaJournalStream << juce::String(deltaText.getNumBytesAsUTF8()) << "\n" << deltaText << "\n";
+	}
+
+	auto success = m_storage->append(getAuxiliaryName(".delta"), deltaJournalStream.getData(), deltaJournalStream.getDataSize());
+	recordDiskWrite(success, false, juce::int64(deltaJournalStream.getDataSize()), startTimeMs);
+
+	return success;
+}
+
+/**
+ * Records a write to disk in the metrics. Called on the flush thread.
+ * @param success		True if the write succeeded.
+ * @param fullWrite		True for a full config file write, false for a delta journal append.
+ * @param bytes			The number of bytes written.
+ * @param startTimeMs	The millisecond counter value when the write was started.
+ */
+void AppConfigurationBase::recordDiskWrite(bool success, bool fullWrite, juce::int64 bytes, double startTimeMs)
+{
+	auto durationUs = juce::int64((juce::Time::getMillisecondCounterHiRes() - startTimeMs) * 1000.0);
+
+	std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+	if (!success)
+		m_metrics.failedWrites++;
+	else if (fullWrite)
+		m_metrics.fullWrites++;
+	else
+		m_metrics.deltaJournalAppends++;
+	m_metrics.bytesWritten += bytes;
+	m_metrics.bytesPerWrite.add(bytes);
+	m_metrics.diskWriteTimeUs.add(durationUs);
+}
+
+/**
+ * Replays the records of an existing delta journal onto the in-memory configuration.
+ * A torn last record, e.g. left by a crash during appending, is ignored.
+ * @return	True if the journal was replayed completely, false if it ended with an unreadable record.
+ */
+bool AppConfigurationBase::replayDeltaJournal()
+{
+	auto deltaJournalName = getAuxiliaryName(".delta");
+	if (!m_storage->exists(deltaJournalName) || !m_xml)
+		return true;
+
+	juce::MemoryBlock deltaJournalData;
+	if (!m_storage->read(deltaJournalName, deltaJournalData))
+		return false;
+
+	juce::MemoryInputStream deltaJournalStream(deltaJournalData, false);
+
+	while (!deltaJournalStream.isExhausted())
+	{
+		auto deltaTextLength = deltaJournalStream.readNextLine().getLargeIntValue();
+		if (deltaTextLength <= 0 || deltaTextLength > deltaJournalStream.getNumBytesRemaining())
+			return false;
+
+		juce::MemoryBlock deltaTextData;
+		deltaJournalStream.readIntoMemoryBlock(deltaTextData, static_cast<ssize_t>(deltaTextLength));
+		deltaJournalStream.readNextLine();
+
+		auto delta = juce::parseXML(deltaTextData.toString());
+		if (delta && delta->hasTagName("Patch"))
+		{
+			auto patch = createConfigPatchFromXml(*delta);
+			if (!patch)
+				return false;
+
+			auto effect = ConfigPatchEffect();
+			applyConfigPatchInPlace(*patch, effect);
+		}
+		else
+		{
+			if (!delta || !delta->getFirstChildElement())
+				return false;
+
+			ensureConfigSectionParsed(delta->getFirstChildElement()->getTagName());
+			mergeConfigStateIndexed(*delta->getFirstChildElement(), delta->getStringAttribute("key"));
+		}
+
+		std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+		m_metrics.replayedDeltas++;
+	}
+
+	return true;
+}
+
+/**
+ * Writes the given root element and sections as compact binary tree encoding next to the config.
+ * The header records size and modification time of the xml config the snapshot
+ * corresponds to, to be able to detect a stale snapshot when the xml was edited in the meantime.
+ * @param rootXml		The root element that was just written to the config file, its children are ignored.
+ * @param sectionXmls	The sections that were just written to the config file.
+ * @return	True on success.
+ */
+bool AppConfigurationBase::writeBinarySnapshot(const juce::XmlElement& rootXml, const std::vector<const juce::XmlElement*>& sectionXmls)
+{
+	auto xmlSize = m_storage->getSize(m_configName);
+	auto xmlModificationTime = m_storage->getModificationTime(m_configName);
+
+	return m_storage->writeAtomically(getAuxiliaryName(".bin"), [&](juce::OutputStream& snapshotStream) {
+		snapshotStream.writeInt(s_binarySnapshotMagic);
+		snapshotStream.writeInt(s_binarySnapshotFormatVersion);
+		snapshotStream.writeInt64(xmlSize);
+		snapshotStream.writeInt64(xmlModificationTime);
+		writeBinaryXml(snapshotStream, rootXml, sectionXmls);
+		snapshotStream.writeInt(s_binarySnapshotMagic);
+	});
+}
+
+/**
+ * Reads the binary snapshot of the config, memory mapped by file based storage backends
+ * and decoded in a single pass without copying it first.
+ * @return	The xml tree, or nullptr if the snapshot is missing, corrupt or stale compared to the xml config.
+ */
+std::unique_ptr<juce::XmlElement> AppConfigurationBase::readBinarySnapshot()
+{
+	auto snapshotName = getAuxiliaryName(".bin");
+	if (!m_storage->exists(snapshotName))
+		return nullptr;
+
+	// queried beforehand, since the storage may be locked while the snapshot is mapped
+	auto xmlFileSize = m_storage->getSize(m_configName);
+	auto xmlFileModificationTime = m_storage->getModificationTime(m_configName);
+
+	std::unique_ptr<juce::XmlElement> xml;
+	auto mapped = m_storage->readMapped(snapshotName, [&](const void* snapshotData, size_t snapshotSize) {
+		juce::MemoryInputStream snapshotStream(snapshotData, snapshotSize, false);
+		if (snapshotStream.readInt() != s_binarySnapshotMagic || snapshotStream.readInt() != s_binarySnapshotFormatVersion)
+			return;
+
+		if (snapshotStream.readInt64() != xmlFileSize || snapshotStream.readInt64() != xmlFileModificationTime)
+		{
+			DBG(juce::String(__FUNCTION__) + " binary snapshot is stale, falling back to xml");
+			return;
+		}
+
+		xml = readBinaryXml(snapshotStream);
+		if (xml && snapshotStream.readInt() != s_binarySnapshotMagic)
+			xml.reset();
+	});
+
+	return mapped ? std::move(xml) : nullptr;
+}
+
+/**
+ * Reads the config file, decompressing it if it is gzip compressed.
+ * @param configData	The target for the uncompressed config file data.
+ * @return	True if the file was read successfully.
+ */
+bool AppConfigurationBase::readConfigFile(juce::MemoryBlock& configData) const
+{
+	if (!m_storage->read(m_configName, configData))
+		return false;
+
+	decompressConfigData(configData);
+
+	return true;
+}
+
+/**
+ * Decompresses config file data in place, if it is gzip compressed.
+ * @param configData	The config file data.
+ */
+void AppConfigurationBase::decompressConfigData(juce::MemoryBlock& configData)
+{
+	if (!isGZipData(configData.getData(), configData.getSize()))
+		return;
+
+	juce::MemoryInputStream compressedStream(configData, false);
+	juce::GZIPDecompressorInputStream decompressorStream(&compressedStream, false, juce::GZIPDecompressorInputStream::gzipFormat);
+	juce::MemoryBlock decompressedData;
+	decompressorStream.readIntoMemoryBlock(decompressedData);
+	configData = decompressedData;
+}
+
+/**
+ * Checks the config file's leading magic bytes for gzip compression.
+ * @return	True if the config file is gzip compressed.
+ */
+bool AppConfigurationBase::isConfigFileCompressed() const
+{
+	juce::MemoryBlock magic;
+
+	return m_storage->read(m_configName, magic, 2) && isGZipData(magic.getData(), magic.getSize());
+}
+
+bool AppConfigurationBase::isGZipData(const void* data, size_t size)
+{
+	auto bytes = static_cast<const juce::uint8*>(data);
+	return size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b;
+}
+
+juce::String AppConfigurationBase::getAuxiliaryName(const juce::String& suffix) const
+{
+	return m_configName + suffix;
+}
+
+juce::String AppConfigurationBase::getShardPrefix() const
+{
+	return getAuxiliaryName(".shards/");
+}
+
+juce::String AppConfigurationBase::getShardName(const juce::String& tagName) const
+{
+	return getShardPrefix() + juce::File::createLegalFileName(tagName) + ".xml";
+}
+
+/**
+ * Loads all shards in parallel and moves their sections into m_xml. Sections of the root file
+ * with the same tag name are replaced by the shard's, unless the shard is older than the root file.
+ * This is the case if switching to single file storage wrote the root file, but did not remove the shards.
+ * @return	True if all shards were loaded, false if any shard could not be read.
+ */
+bool AppConfigurationBase::loadShards()
+{
+	auto shardNames = m_storage->getNames(getShardPrefix());
+	if (shardNames.isEmpty())
+		return true;
+
+	auto& storage = *m_storage;
+	std::vector<std::future<std::unique_ptr<juce::XmlElement>>> shardLoads;
+	for (auto const& shardName : shardNames)
+		shardLoads.push_back(std::async(std::launch::async, [&storage, shardName]() { return readShard(storage, shardName); }));
+
+	auto success = true;
+	auto rootModificationTime = m_storage->getModificationTime(m_configName);
+	for (size_t i = 0; i < shardLoads.size(); ++i)
+	{
+		auto shardXml = shardLoads[i].get();
+		if (!shardXml || !shardXml->hasTagName(m_xml->getTagName()))
+		{
+			DBG(juce::String(__FUNCTION__) + " unable to load shard " + m_storage->getDisplayName(shardNames[int(i)]));
+			success = false;
+			continue;
+		}
+
+		juce::StringArray tagNames;
+		for (auto sectionXml : shardXml->getChildIterator())
+			tagNames.addIfNotAlreadyThere(sectionXml->getTagName());
+
+		auto shardIsOutdated = false;
+		for (auto const& tagName : tagNames)
+		{
+			parseUnparsedSections(*m_xml, m_unparsedSections, tagName);
+			shardIsOutdated |= m_xml->getChildByName(tagName) != nullptr && m_storage->getModificationTime(shardNames[int(i)]) < rootModificationTime;
+		}
+		if (shardIsOutdated)
+			continue;
+
+		for (auto const& tagName : tagNames)
+			while (auto rootSectionXml = m_xml->getChildByName(tagName))
+				m_xml->removeChildElement(rootSectionXml, true);
+		while (auto sectionXml = shardXml->getFirstChildElement())
+		{
+			shardXml->removeChildElement(sectionXml, false);
+			m_xml->addChildElement(sectionXml);
+		}
+	}
+
+	return success;
+}
+
+/**
+ * Writes the given sections as shard, replacing the previous one atomically.
+ * Called on the flush thread.
+ * @param shardName		The name of the shard in the storage backend.
+ * @param rootTagName	The configuration's root tag name, used as the shard's root element.
+ * @param sections		The sections contained in the shard.
+ * @return	True on success.
+ */
+bool AppConfigurationBase::writeShard(const juce::String& shardName, const juce::String& rootTagName, const std::vector<std::shared_ptr<const juce::XmlElement>>& sections)
+{
+	auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+	auto bytes = juce::int64(0);
+
+	auto writeShardXml = [&](juce::OutputStream& stream) {
+		auto newLine = "\r\n";
+		stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << newLine << newLine;
+		stream << "<" << rootTagName << ">" << newLine;
+		for (auto const& sectionXml : sections)
+			sectionXml->writeTo(stream, juce::XmlElement::TextFormat().withoutHeader());
+		stream << "</" << rootTagName << ">" << newLine;
+	};
+
+	auto success = m_storage->writeAtomically(shardName, [&](juce::OutputStream& stream) {
+		auto startPosition = stream.getPosition();
+		if (m_compressedStorage)
+		{
+			juce::GZIPCompressorOutputStream compressorStream(stream, 6, juce::GZIPCompressorOutputStream::windowBitsGZIP);
+			writeShardXml(compressorStream);
+			compressorStream.flush();
+		}
+		else
+			writeShardXml(stream);
+		bytes = stream.getPosition() - startPosition;
+	});
+	recordDiskWrite(success, true, bytes, startTimeMs);
+
+	return success;
+}
+
+/**
+ * Reads and parses a shard, decompressing it if it is gzip compressed.
+ * @param storage	The storage backend to read from.
+ * @param shardName	The name of the shard to read.
+ * @return	The shard's root element, nullptr if it could not be read.
+ */
+std::unique_ptr<juce::XmlElement> AppConfigurationBase::readShard(const AppConfigurationStorage& storage, const juce::String& shardName)
+{
+	juce::MemoryBlock shardData;
+	if (!storage.read(shardName, shardData))
+		return nullptr;
+
+	decompressConfigData(shardData);
+
+	return juce::parseXML(juce::String::fromUTF8(static_cast<const char*>(shardData.getData()), int(shardData.getSize())));
+}
+
+/**
+ * Calculates a hash per shard, i.e. per top-level section tag name, from the section hashes of a snapshot.
+ * @param snapshot	The snapshot to hash the shards of.
+ * @return	The shard hashes by tag name.
+ */
+std::map<juce::String, juce::uint64> AppConfigurationBase::getShardHashes(const ConfigSnapshot& snapshot)
+{
+	std::map<juce::String, juce::uint64> shardHashes;
+	for (auto const& section : snapshot.m_sections)
+	{
+		auto& shardHash = shardHashes.emplace(section.tagName, s_fnvOffsetBasis).first->second;
+		shardHash = hashValue(shardHash, section.hashes->hash);
+	}
+
+	return shardHashes;
+}
+
+bool AppConfigurationBase::initializeFromDisk()
+{
+	invalidateConfigStateIndex();
+	m_loadedStateMatchesDisk = false;
+
+	auto loadStartTimeMs = juce::Time::getMillisecondCounterHiRes();
+	auto loadedFromBinarySnapshot = false;
+
+	// a binary snapshot is not maintained for sharded storage
+	if (IsBinarySnapshotEnabled() && !m_shardedStorageEnabled)
+	{
+		m_xml = readBinarySnapshot();
+		loadedFromBinarySnapshot = (m_xml != nullptr);
+	}
+	if (!m_xml)
+	{
+		juce::MemoryBlock configData;
+		if (readConfigFile(configData))
+		{
+			juce::String rootStartTag;
+			juce::StringArray sectionTagNames, sectionTexts;
+			if (IsLazySectionParsingEnabled()
+				&& indexTopLevelSections(static_cast<const char*>(configData.getData()), int(configData.getSize()), rootStartTag, sectionTagNames, sectionTexts))
+			{
+				m_xml = juce::parseXML(rootStartTag);
+				for (int i = 0; m_xml && i < sectionTagNames.size(); ++i)
+					m_unparsedSections.push_back({ sectionTagNames[i], sectionTexts[i] });
+			}
+			if (!m_xml)
+				m_xml = juce::parseXML(juce::String::fromUTF8(static_cast<const char*>(configData.getData()), int(configData.getSize())));
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+		m_metrics.loadTimeUs.add(juce::int64((juce::Time::getMillisecondCounterHiRes() - loadStartTimeMs) * 1000.0));
+		if (loadedFromBinarySnapshot)
+			m_metrics.binarySnapshotLoads++;
+	}
+
+	if (!m_xml && m_storage->getSize(m_configName) > 0)
+	{
+		// Keep the unreadable config for inspection instead of silently overwriting it with an empty configuration
+		auto corruptName = getAuxiliaryName(".corrupt");
+		DBG(juce::String(__FUNCTION__) + " unable to parse " + m_storage->getDisplayName(m_configName) + ", keeping a copy as " + m_storage->getDisplayName(corruptName));
+		juce::MemoryBlock corruptData;
+		if (!m_storage->read(m_configName, corruptData)
+			|| !m_storage->writeAtomically(corruptName, [&corruptData](juce::OutputStream& stream) { stream.write(corruptData.getData(), corruptData.getSize()); }))
+			jassertfalse;
+	}
+
+	if (m_xml && m_xml->hasTagName(getRootTagName()))
+	{
+		// Shards are loaded regardless of the current storage mode, to not lose sections when switching modes
+		auto rootFileHasSections = m_xml->getNumChildElements() > 0 || !m_unparsedSections.empty();
+		auto shardsFound = !m_storage->getNames(getShardPrefix()).isEmpty();
+		if (!loadShards())
+			DBG(juce::String(__FUNCTION__) + " unable to load all shards from " + m_storage->getDisplayName(getShardPrefix()));
+
+		// A journal is replayed regardless of the current persistence mode, to not lose changes when switching modes.
+		// It is replayed before the config version is checked, since the next full write removes it.
+		auto deltaJournalReplayed = m_storage->exists(getAuxiliaryName(".delta"));
+		if (!replayDeltaJournal())
+			DBG(juce::String(__FUNCTION__) + " delta journal ended with an incomplete record");
+
+		// a binary snapshot is only written for fully parsed configurations
+		auto binarySnapshotMissing = IsBinarySnapshotEnabled() && !m_shardedStorageEnabled && !loadedFromBinarySnapshot && m_unparsedSections.empty();
+		auto compressionChanged = isConfigFileCompressed() != m_compressedStorage;
+		auto storageModeChanged = m_shardedStorageEnabled ? rootFileHasSections : shardsFound;
+		m_loadedStateMatchesDisk = !deltaJournalReplayed && !binarySnapshotMissing && !compressionChanged && !storageModeChanged;
+
+		if (UsesConfigVersion())
+		{
+			const juce::String cfgVAttributeName = "configVersion";
+			if (!m_xml->hasAttribute(cfgVAttributeName))
+			{
+				m_xml->setAttribute(cfgVAttributeName, m_configVersion.ToString());
+				m_loadedStateMatchesDisk = false;
+			}
+			else
+			{
+				auto configVersionFound = Version::FromString(m_xml->getStringAttribute(cfgVAttributeName));
+				if (configVersionFound != m_configVersion)
+				{
+					// the conflict handling may migrate the loaded state, which then needs to be written
+					m_loadedStateMatchesDisk = false;
+					return HandleConfigVersionConflict(configVersionFound);
+				}
+			}
+		}
+		
+		return true;		
+	}
+	else
+	{
+		m_xml = std::make_unique<juce::XmlElement>(getRootTagName());
+	}
+		
+	return false;
+}
+
+/**
+ * Hands the current configuration over to the flush thread, as a full copy or as deltas,
+ * and requests a new flush generation to be written.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ * @param completion			Optional promise to be fulfilled when the requested generation was written,
+ *								with false if no write was requested, since flushing is disabled or deferred.
+ * @return	True on success, false if the configuration is not initialized.
+ */
+bool AppConfigurationBase::flush(bool includeWatcherUpdate, std::promise<bool>* completion)
+{
+	if (!m_xml)
+	{
+		if (completion != nullptr)
+			completion->set_value(false);
+		return false;
+	}
+
+	writeBackTypedValues();
+
+	if (isInTransaction()) // flushing is deferred until the outermost transaction is committed
+	{
+		m_transactionSavepoints.back().flushDeferred = true;
+		m_transactionSavepoints.back().watcherUpdateDeferred |= includeWatcherUpdate;
+		if (completion != nullptr)
+			completion->set_value(false);
+		return true;
+	}
+
+	stageUnstagedConfigChanges();
+	publishConfigSnapshot();
+
+	if (GetFlushAndUpdateDisabled().first) // check if config flushing to disk is globally disabled
+	{
+#ifdef DEBUG
+		DBG(juce::String(__FUNCTION__) + " config flushing to disk is globally disabled");
+#endif
+		if (completion != nullptr)
+			completion->set_value(false);
+		return true;
+	}
+
+//#ifdef DEBUG
+//	debugPrintXmlTree();
+//#endif
+
+	// other instances see changes of the shared sections right away, independent of the disk write
+	if (!publishSharedSections())
+		DBG(juce::String(__FUNCTION__) + " unable to publish shared sections, retrying with the next poll");
+
+	// The hash of what was last handed over to the flush thread is not what is on disk if writing it failed.
+	// Everything is handed over again in that case, so the write is retried even if the content did not change.
+	if (m_lastFlushWriteFailed.exchange(false))
+	{
+		m_lastFlushedHash = 0;
+		m_fullWriteRequired = true;
+		for (auto& lastFlushedShardHash : m_lastFlushedShardHashes)
+			lastFlushedShardHash.second = 0;
+		m_lastFlushedShardRootHash = 0;
+	}
+
+	// nothing needs to be written if the content equals what was last handed over to the flush thread
+	auto hash = m_lastBuiltSnapshot ? m_lastBuiltSnapshot->getHash() : 0;
+	if (hash == m_lastFlushedHash && (m_persistenceMode == PM_FullSnapshot || m_shardedStorageEnabled || !m_fullWriteRequired))
+	{
+		m_pendingDeltas.clear();
+
+		{
+			std::lock_guard<std::mutex> fileflushlock(m_fileFlushCVMutex);
+			if (completion != nullptr && m_flushRequestedGeneration == m_flushWrittenGeneration)
+				completion->set_value(true);
+			else if (completion != nullptr)
+				m_flushCompletions.emplace_back(m_flushRequestedGeneration, std::move(*completion));
+		}
+		{
+			std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+			m_metrics.skippedFlushes++;
+		}
+
+		if (includeWatcherUpdate)
+			triggerWatcherUpdate();
+
+		return true;
+	}
+	m_lastFlushedHash = hash;
+
+	{
+		std::lock_guard<std::mutex> l(m_xmlCopyAccessMutex);
+		if (m_shardedStorageEnabled)
+		{
+			// Only the shards whose sections changed are handed over. They share the immutable
+			// sections of the snapshot, so no deep copy is required.
+			auto shardHashes = getShardHashes(*m_lastBuiltSnapshot);
+			for (auto const& shardHash : shardHashes)
+			{
+				auto lastFlushedShardHash = m_lastFlushedShardHashes.find(shardHash.first);
+				if (lastFlushedShardHash != m_lastFlushedShardHashes.end() && lastFlushedShardHash->second == shardHash.second)
+					continue;
+
+				auto& shardSections = m_shardFlushQueue[shardHash.first];
+				shardSections.clear();
+				for (auto const& section : m_lastBuiltSnapshot->m_sections)
+					if (section.tagName == shardHash.first)
+						if (auto sectionXml = section.getXml())
+							shardSections.push_back(std::move(sectionXml));
+			}
+			for (auto const& lastFlushedShardHash : m_lastFlushedShardHashes)
+				if (shardHashes.count(lastFlushedShardHash.first) == 0)
+					m_shardFlushQueue[lastFlushedShardHash.first].clear();
+			m_lastFlushedShardHashes = std::move(shardHashes);
+
+			if (m_lastBuiltSnapshot->m_rootAttributesHash != m_lastFlushedShardRootHash)
+			{
+				m_shardRootFlushCopy = std::make_unique<juce::XmlElement>(*m_lastBuiltSnapshot->m_root);
+				m_lastFlushedShardRootHash = m_lastBuiltSnapshot->m_rootAttributesHash;
+			}
+			m_shardRootTagName = m_lastBuiltSnapshot->getRootTagName();
+
+			m_deltaFlushQueue.clear();
+			m_pendingDeltas.clear();
+			m_fullWriteRequired = false;
+		}
+		else if (m_persistenceMode == PM_FullSnapshot || m_fullWriteRequired)
+		{
+			// A full write supersedes all deltas that were not yet journaled. The flush thread
+			// serializes it from the immutable snapshot, no copy of m_xml is required.
+			m_snapshotFlushCopy = m_lastBuiltSnapshot;
+			m_deltaFlushQueue.clear();
+			m_pendingDeltas.clear();
+			m_fullWriteRequired = false;
+		}
+		else
+		{
+			for (auto& delta : m_pendingDeltas)
+				m_deltaFlushQueue.push_back(std::move(delta));
+			m_pendingDeltas.clear();
+		}
+	}
+	{
+		std::lock_guard<std::mutex> fileflushlock(m_fileFlushCVMutex);
+		if (m_flushRequestedGeneration == m_flushWrittenGeneration)
+			m_oldestPendingFlushRequestTimeMs = juce::Time::getMillisecondCounterHiRes();
+		++m_flushRequestedGeneration;
+		if (completion != nullptr)
+			m_flushCompletions.emplace_back(m_flushRequestedGeneration, std::move(*completion));
+	}
+	m_fileFlushCV.notify_all();
+
+	{
+		std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+		m_metrics.flushRequests++;
+	}
+
+	if (includeWatcherUpdate)
+		triggerWatcherUpdate();
+
+	return true;
+}
+
+void AppConfigurationBase::addDumper(AppConfigurationBase::Dumper* d)
+{
+	m_dumpers.push_back(d);
+}
+
+void AppConfigurationBase::triggerConfigurationDump(bool includeWatcherUpdate)
+{
+	if (!IsFlushCoalescingEnabled())
+	{
+		performConfigurationDump(includeWatcherUpdate);
+		return;
+	}
+
+	m_dumpPendingIncludesDumpers = true;
+	schedulePendingConfigurationDump(includeWatcherUpdate);
+}
+
+/**
+ * Flushes the configuration without dumping the registered Dumpers, for changes that were made
+ * to the configuration directly, e.g. replicated sections or patches. The request is coalesced
+ * with other dump and flush requests within the configured coalescing window.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ */
+void AppConfigurationBase::triggerConfigurationFlush(bool includeWatcherUpdate)
+{
+	if (!IsFlushCoalescingEnabled())
+	{
+		flush(includeWatcherUpdate);
+		return;
+	}
+
+	schedulePendingConfigurationDump(includeWatcherUpdate);
+}
+
+/**
+ * Marks a dump or flush as pending and makes sure the pending request is processed
+ * as soon as the coalescing window allows.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ */
+void AppConfigurationBase::schedulePendingConfigurationDump(bool includeWatcherUpdate)
+{
+	auto now = juce::Time::getMillisecondCounter();
+	if (!m_dumpPending)
+	{
+		m_dumpPending = true;
+		m_firstPendingDumpRequestTime = now;
+	}
+	m_lastPendingDumpRequestTime = now;
+	m_dumpPendingIncludesWatcherUpdate |= includeWatcherUpdate;
+
+	// The first request of a burst is evaluated on the next message loop iteration instead of right away,
+	// so requests made within the same iteration are coalesced even without a minimum interval.
+	if (!m_dumpScheduler)
+		m_dumpScheduler = std::make_unique<DumpScheduler>(*this);
+	if (!m_dumpScheduler->isTimerRunning())
+		m_dumpScheduler->triggerAsyncUpdate();
+}
+
+/**
+ * Processes a pending coalesced configuration dump right away, regardless of the
+ * configured coalescing window. This is the escape hatch to be used e.g. on shutdown,
+ * to make sure the last changes are dumped and flushed to disk.
+ * @return  True if no dump was pending or the pending dump was flushed successfully.
+ */
+bool AppConfigurationBase::flushPendingConfigurationDump()
+{
+	if (m_dumpScheduler)
+	{
+		m_dumpScheduler->stopTimer();
+		m_dumpScheduler->cancelPendingUpdate();
+	}
+
+	if (!m_dumpPending)
+		return true;
+
+	auto includeWatcherUpdate = m_dumpPendingIncludesWatcherUpdate;
+	auto includeDumpers = m_dumpPendingIncludesDumpers;
+	m_dumpPending = false;
+	m_dumpPendingIncludesWatcherUpdate = false;
+	m_dumpPendingIncludesDumpers = false;
+
+	if (includeDumpers)
+		performConfigurationDump(includeWatcherUpdate);
+	else
+		flush(includeWatcherUpdate);
+
+	return true;
+}
+
+/**
+ * Dumps the registered Dumpers and flushes the result. Dumpers that use dirty tracking
+ * are only included if they were flagged as modified since their last dump.
+ * @param includeWatcherUpdate	True to notify the watchers after flushing.
+ */
+void AppConfigurationBase::performConfigurationDump(bool includeWatcherUpdate)
+{
+	if (isInTransaction()) // dumping is deferred until the outermost transaction is committed
+	{
+		m_transactionSavepoints.back().dumpDeferred = true;
+		m_transactionSavepoints.back().watcherUpdateDeferred |= includeWatcherUpdate;
+		return;
+	}
+
+	auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+	for (const auto& d : m_dumpers)
+	{
+		if (!d->isConfigurationDumpRequired())
+			continue;
+
+		// reset before dumping, to not lose modifications flagged while the dump is in progress
+		d->setConfigurationDirty(false);
+		d->performConfigurationDump();
+	}
+	auto dumperTimeUs = juce::int64((juce::Time::getMillisecondCounterHiRes() - startTimeMs) * 1000.0);
+	{
+		std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+		m_metrics.dumperTimeUs.add(dumperTimeUs);
+	}
+
+	flush(includeWatcherUpdate);
+}
+
+/**
+ * Checks if the pending coalesced dump is due, either because no further dump
+ * request arrived for the minimum interval or because the first pending request
+ * has been waiting for the maximum latency. If it is not yet due, the scheduler
+ * timer is rearmed for the remaining time.
+ */
+void AppConfigurationBase::processPendingConfigurationDump()
+{
+	if (!m_dumpPending)
+	{
+		m_dumpScheduler->stopTimer();
+		return;
+	}
+
+	auto now = juce::Time::getMillisecondCounter();
+	auto quietPeriodEnd = m_lastPendingDumpRequestTime + juce::uint32(m_flushCoalescingMinIntervalMs);
+	auto maxLatencyEnd = m_firstPendingDumpRequestTime + juce::uint32(juce::jmax(m_flushCoalescingMinIntervalMs, m_flushCoalescingMaxLatencyMs));
+	auto msUntilQuiet = int(quietPeriodEnd - now);
+	auto msUntilMaxLatency = int(maxLatencyEnd - now);
+
+	auto msUntilDue = juce::jmin(msUntilQuiet, msUntilMaxLatency);
+	if (msUntilDue <= 0)
+		flushPendingConfigurationDump();
+	else
+		m_dumpScheduler->startTimer(msUntilDue);
+}
+
+/**
+ * Configures the window used to coalesce bursts of configuration dump requests.
+ * A pending dump is processed as soon as no further request arrived for minIntervalMs,
+ * but at the latest maxLatencyMs after the first request of the burst.
+ * With a minIntervalMs of zero, the requests made within one message loop iteration are coalesced.
+ * Setting both values to zero restores immediate dumping on every request.
+ * @param minIntervalMs	The quiet period in ms after the last request before dumping.
+ * @param maxLatencyMs	The maximum time in ms a request may be delayed.
+ */
+void AppConfigurationBase::SetFlushCoalescingWindow(int minIntervalMs, int maxLatencyMs)
+{
+	m_flushCoalescingMinIntervalMs = juce::jmax(0, minIntervalMs);
+	m_flushCoalescingMaxLatencyMs = juce::jmax(0, maxLatencyMs);
+
+	if (!IsFlushCoalescingEnabled())
+		flushPendingConfigurationDump();
+}
+
+bool AppConfigurationBase::IsFlushCoalescingEnabled() const
+{
+	return m_flushCoalescingMinIntervalMs > 0 || m_flushCoalescingMaxLatencyMs > 0;
+}
+
+void AppConfigurationBase::clearDumpers()
+{
+	m_dumpers.clear();
+}
+
+void AppConfigurationBase::addWatcher(AppConfigurationBase::Watcher* w, bool initialUpdate)
+{
+	if (initialUpdate)
+		w->onConfigUpdated();
+
+	m_watchers.push_back(w);
+}
+
+/**
+ * Adds a watcher that is only notified of changes affecting the given section paths.
+ * A path is either a top-level section tag name or 'Section/Child' to address a child of a section.
+ * @param w				The watcher to add.
+ * @param sectionPaths	The paths the watcher subscribes to.
+ * @param initialUpdate	True to notify the watcher right away.
+ */
+void AppConfigurationBase::addWatcher(AppConfigurationBase::Watcher* w, const juce::StringArray& sectionPaths, bool initialUpdate)
+{
+	m_watcherSubscriptions[w] = sectionPaths;
+
+	if (initialUpdate)
+	{
+		auto changes = ConfigChangeSet();
+		changes.setFullChange();
+		w->onConfigChanged(changes);
+	}
+
+	m_watchers.push_back(w);
+}
+
+void AppConfigurationBase::triggerWatcherUpdate()
+{
+	if (isInTransaction()) // watchers are updated when the outermost transaction is committed
+	{
+		m_transactionSavepoints.back().watcherUpdateDeferred = true;
+		return;
+	}
+
+	if (GetFlushAndUpdateDisabled().second) // check if watcher updating is globally disabled
+	{
+#ifdef DEBUG
+		DBG(juce::String(__FUNCTION__) + " config watcher updating is globally disabled");
+#endif
+		return;
+	}
+
+	if (m_watcherUpdateDispatcher)
+		m_watcherUpdateDispatcher->triggerAsyncUpdate();
+	else
+		dispatchWatcherUpdate();
+}
+
+/**
+ * Notifies the watchers of the changes collected since the last notification. Watchers added
+ * without subscription are notified on every update, subscribed watchers only if the changes
+ * affect one of their paths.
+ */
+void AppConfigurationBase::dispatchWatcherUpdate()
+{
+	auto changes = ConfigChangeSet();
+	std::swap(changes, m_pendingConfigChanges);
+
+	auto startTimeMs = juce::Time::getMillisecondCounterHiRes();
+	for (const auto& w : m_watchers)
+	{
+		auto subscription = m_watcherSubscriptions.find(w);
+		if (subscription == m_watcherSubscriptions.end() || changes.affectsAnyPath(subscription->second))
+			w->onConfigChanged(changes);
+	}
+	auto watcherTimeUs = juce::int64((juce::Time::getMillisecondCounterHiRes() - startTimeMs) * 1000.0);
+	{
+		std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+		m_metrics.watcherTimeUs.add(watcherTimeUs);
+	}
+}
+
+void AppConfigurationBase::clearWatchers()
+{
+	m_watchers.clear();
+	m_watcherSubscriptions.clear();
+}
+
+/**
+ * Selects if watchers are notified synchronously when a watcher update is triggered,
+ * or asynchronously on the message thread, coalescing all updates triggered
+ * within one message loop iteration into a single notification.
+ * @param asynchronous	True to notify watchers asynchronously.
+ */
+void AppConfigurationBase::SetWatcherUpdateAsynchronous(bool asynchronous)
+{
+	if (asynchronous && !m_watcherUpdateDispatcher)
+		m_watcherUpdateDispatcher = std::make_unique<WatcherUpdateDispatcher>(*this);
+	else if (!asynchronous && m_watcherUpdateDispatcher)
+	{
+		m_watcherUpdateDispatcher->handleUpdateNowIfNeeded();
+		m_watcherUpdateDispatcher.reset();
+	}
+}
+
+bool AppConfigurationBase::IsWatcherUpdateAsynchronous() const
+{
+	return m_watcherUpdateDispatcher != nullptr;
+}
+
+/**
+ * Adds changes to the set of changes the watchers are notified of with the next update.
+ * Derived classes that modify m_xml directly can use this to describe their changes.
+ * @param changes	The changes to add.
+ */
+void AppConfigurationBase::addPendingConfigChanges(const ConfigChangeSet& changes)
+{
+	m_pendingConfigChanges.merge(changes);
+}
+
+std::unique_ptr<juce::XmlElement> AppConfigurationBase::getConfigState(juce::StringRef tagName)
+{
+	if (m_xml)
+	{
+		ensureConfigSectionParsed(tagName);
+
+		if (tagName.isEmpty())
+			return std::make_unique<juce::XmlElement>(*m_xml);
+
+		juce::XmlElement *tagNameElement = m_xml->getChildByName(tagName);
+		if (tagNameElement)
+			return std::make_unique<juce::XmlElement>(*tagNameElement);
+		else
+			return nullptr;
+	}
+	else
+		return nullptr;
+}
+
+bool AppConfigurationBase::setConfigState(std::unique_ptr<juce::XmlElement> stateXml, juce::StringRef attributeName)
+{
+	if (stateXml && m_xml)
+	{
+		ensureConfigSectionParsed(stateXml->getTagName());
+
+		auto changes = ConfigChangeSet();
+		auto mergedElement = mergeConfigStateIndexed(*stateXml, attributeName, &changes);
+		if (!mergedElement)
+			return false;
+		if (changes.isEmpty())
+			return true; // the state is unchanged
+
+		addPendingConfigChanges(changes);
+
+		// the state xml is not modified any more from here on and can be shared by the snapshot and the delta journal
+		auto sharedStateXml = std::shared_ptr<const juce::XmlElement>(stateXml.release());
+		stageConfigSnapshotSection(mergedElement, sharedStateXml);
+
+		if (m_persistenceMode == PM_DeltaJournal && !m_fullWriteRequired)
+			m_pendingDeltas.push_back({ juce::String(attributeName), sharedStateXml, nullptr });
+
+		return true;
+	}
+		
+	return false;
+}
+
+bool AppConfigurationBase::resetConfigState(std::unique_ptr<juce::XmlElement> fullStateXml)
+{
+	auto previousSnapshot = buildConfigSnapshot();
+
+	m_xml.reset(fullStateXml.release());
+	m_unparsedSections.clear();
+	invalidateConfigStateIndex();
+	m_snapshotRootPublishRequired = true;
+
+	// the changes are determined by descending only into the subtrees whose hashes differ
+	auto snapshot = buildConfigSnapshot();
+	auto changes = ConfigChangeSet();
+	if (previousSnapshot && snapshot)
+		collectSnapshotChanges(*previousSnapshot, *snapshot, changes);
+	else
+		changes.setFullChange();
+
+	if (!changes.isEmpty())
+		m_fullWriteRequired = true;
+
+	publishConfigSnapshot();
+
+	addPendingConfigChanges(changes);
+
+	triggerWatcherUpdate();
+
+	return true;
+}
+
+/**
+ * Applies the mutations of the given patch in place to the section of m_xml it targets.
+ * Unlike setConfigState, no new state of the whole section has to be built and merged.
+ * The patch itself is journaled as the delta and the section is not cloned for the next
+ * snapshot; the snapshot shares the previous section xml and the patches instead.
+ * @param patch	The patch to apply.
+ * @return	True on success, false if the configuration is not initialized.
+ */
+bool AppConfigurationBase::applyConfigPatch(const ConfigPatch& patch)
+{
+	if (!m_xml || patch.m_sectionTagName.isEmpty())
+		return false;
+
+	auto effect = ConfigPatchEffect();
+	auto sectionXml = applyConfigPatchInPlace(patch, effect);
+	if (effect.changes.isEmpty())
+		return true; // the state is unchanged
+
+	addPendingConfigChanges(effect.changes);
+
+	// the patch is shared by the snapshot and the delta journal
+	auto sharedPatch = std::make_shared<const ConfigPatch>(patch);
+	if (m_persistenceMode == PM_DeltaJournal && !m_fullWriteRequired)
+		m_pendingDeltas.push_back({ patch.m_keyAttributeName, nullptr, sharedPatch });
+
+	stagePatchedConfigSnapshotSection(sectionXml, std::move(sharedPatch), effect);
+
+	return true;
+}
+
+/**
+ * Applies the mutations of the given patch to the section of m_xml it targets, which is
+ * created if it does not exist yet, and drops the state indices the patch outdated.
+ * @param patch		The patch to apply.
+ * @param effect	The effect to record the changes of the patch in.
+ * @return	The patched section element.
+ */
+juce::XmlElement* AppConfigurationBase::applyConfigPatchInPlace(const ConfigPatch& patch, ConfigPatchEffect& effect)
+{
+	ensureConfigSectionParsed(patch.m_sectionTagName);
+
+	juce::XmlElement* sectionXml = nullptr;
+	if (patch.m_keyAttributeName.isNotEmpty())
+	{
+		auto& index = getConfigStateIndex(patch.m_sectionTagName, patch.m_keyAttributeName);
+		auto existingSection = index.find(patch.m_keyAttributeValue);
+		if (existingSection != index.end())
+			sectionXml = existingSection->second;
+	}
+	else
+		sectionXml = m_xml->getChildByName(patch.m_sectionTagName);
+
+	if (sectionXml == nullptr)
+	{
+		sectionXml = m_xml->createNewChildElement(patch.m_sectionTagName);
+		if (patch.m_keyAttributeName.isNotEmpty())
+			sectionXml->setAttribute(patch.m_keyAttributeName, patch.m_keyAttributeValue);
+		invalidateConfigStateIndex(patch.m_sectionTagName);
+		effect.changes.addChangedPath(patch.m_sectionTagName);
+	}
+
+	applyConfigPatchOperations(*sectionXml, patch, effect);
+
+	// indices keyed by a changed attribute are outdated
+	for (auto const& operation : patch.m_operations)
+		if (operation.type == ConfigPatch::OT_SetAttribute || operation.type == ConfigPatch::OT_RemoveAttribute)
+			m_configStateIndex.erase(std::make_pair(patch.m_sectionTagName, operation.name));
+
+	return sectionXml;
+}
+
+/**
+ * Applies the mutations of the given patch to a section element. This is used for the live
+ * configuration as well as for materializing patched snapshot sections and the journal base.
+ * Mutations that do not change the state are skipped.
+ * @param sectionXml	The section element to patch.
+ * @param patch			The patch to apply.
+ * @param effect		The effect to record the changes of the patch in.
+ */
+void AppConfigurationBase::applyConfigPatchOperations(juce::XmlElement& sectionXml, const ConfigPatch& patch, ConfigPatchEffect& effect)
+{
+	auto const& sectionTagName = patch.m_sectionTagName;
+	for (auto const& operation : patch.m_operations)
+	{
+		switch (operation.type)
+		{
+		case ConfigPatch::OT_SetAttribute:
+			if (sectionXml.hasAttribute(operation.name) && sectionXml.getStringAttribute(operation.name) == operation.value)
+				continue;
+			sectionXml.setAttribute(operation.name, operation.value);
+			effect.changes.addChangedPath(sectionTagName);
+			break;
+		case ConfigPatch::OT_RemoveAttribute:
+			if (!sectionXml.hasAttribute(operation.name))
+				continue;
+			sectionXml.removeAttribute(operation.name);
+			effect.changes.addChangedPath(sectionTagName);
+			break;
+		case ConfigPatch::OT_SetChildAttribute:
+			{
+				auto childXml = sectionXml.getChildByName(operation.childTagName);
+				if (childXml == nullptr)
+				{
+					childXml = sectionXml.createNewChildElement(operation.childTagName);
+					effect.childStructureChanged = true;
+				}
+				else if (childXml->hasAttribute(operation.name) && childXml->getStringAttribute(operation.name) == operation.value)
+					continue;
+				else
+					effect.changedChildTagNames.addIfNotAlreadyThere(operation.childTagName);
+				childXml->setAttribute(operation.name, operation.value);
+				effect.changes.addChangedPath(sectionTagName + "/" + operation.childTagName);
+			}
+			break;
+		case ConfigPatch::OT_ReplaceChild:
+			{
+				auto existingChildXml = sectionXml.getChildByName(operation.childXml->getTagName());
+				if (existingChildXml != nullptr && existingChildXml->isEquivalentTo(operation.childXml.get(), false))
+					continue;
+				if (existingChildXml != nullptr)
+				{
+					sectionXml.replaceChildElement(existingChildXml, new juce::XmlElement(*operation.childXml));
+					effect.changedChildTagNames.addIfNotAlreadyThere(operation.childXml->getTagName());
+				}
+				else
+				{
+					sectionXml.addChildElement(new juce::XmlElement(*operation.childXml));
+					effect.childStructureChanged = true;
+				}
+				effect.changes.addChangedPath(sectionTagName + "/" + operation.childXml->getTagName());
+			}
+			break;
+		case ConfigPatch::OT_RemoveChild:
+			{
+				auto existingChildXml = sectionXml.getChildByName(operation.childTagName);
+				if (existingChildXml == nullptr)
+					continue;
+				sectionXml.removeChildElement(existingChildXml, true);
+				effect.childStructureChanged = true;
+				effect.changes.addChangedPath(sectionTagName + "/" + operation.childTagName);
+			}
+			break;
+		default:
+			jassertfalse;
+			break;
+		}
+	}
+}
+
+/**
+ * Finds the section of the given root element a patch targets by walking its children,
+ * for trees that are not covered by the state indices. The section is created if it does
+ * not exist yet.
+ * @param rootXml	The root element to search.
+ * @param patch		The patch to find the section for.
+ * @return	The section element.
+ */
+juce::XmlElement* AppConfigurationBase::findConfigPatchTarget(juce::XmlElement& rootXml, const ConfigPatch& patch)
+{
+	for (auto sectionXml : rootXml.getChildIterator())
+	{
+		if (!sectionXml->hasTagName(patch.m_sectionTagName))
+			continue;
+		if (patch.m_keyAttributeName.isEmpty())
+			return sectionXml;
+		if (sectionXml->hasAttribute(patch.m_keyAttributeName) && sectionXml->getIntAttribute(patch.m_keyAttributeName) == patch.m_keyAttributeValue)
+			return sectionXml;
+	}
+
+	auto sectionXml = rootXml.createNewChildElement(patch.m_sectionTagName);
+	if (patch.m_keyAttributeName.isNotEmpty())
+		sectionXml->setAttribute(patch.m_keyAttributeName, patch.m_keyAttributeValue);
+	return sectionXml;
+}
+
+/**
+ * Serializes a patch into a delta journal record.
+ * @param patch	The patch to serialize.
+ * @return	The <Patch> record element.
+ */
+std::unique_ptr<juce::XmlElement> AppConfigurationBase::createConfigPatchXml(const ConfigPatch& patch)
+{
+	auto patchXml = std::make_unique<juce::XmlElement>("Patch");
+	patchXml->setAttribute("section", patch.m_sectionTagName);
+	if (patch.m_keyAttributeName.isNotEmpty())
+	{
+		patchXml->setAttribute("key", patch.m_keyAttributeName);
+		patchXml->setAttribute("keyValue", patch.m_keyAttributeValue);
+	}
+
+	for (auto const& operation : patch.m_operations)
+	{
+		switch (operation.type)
+		{
+		case ConfigPatch::OT_SetAttribute:
+			{
+				auto operationXml = patchXml->createNewChildElement("SetAttribute");
+				operationXml->setAttribute("name", operation.name);
+				operationXml->setAttribute("value", operation.value);
+			}
+			break;
+		case ConfigPatch::OT_RemoveAttribute:
+			patchXml->createNewChildElement("RemoveAttribute")->setAttribute("name", operation.name);
+			break;
+		case ConfigPatch::OT_SetChildAttribute:
+			{
+				auto operationXml = patchXml->createNewChildElement("SetChildAttribute");
+				operationXml->setAttribute("child", operation.childTagName);
+				operationXml->setAttribute("name", operation.name);
+				operationXml->setAttribute("value", operation.value);
+			}
+			break;
+		case ConfigPatch::OT_ReplaceChild:
+			patchXml->createNewChildElement("ReplaceChild")->addChildElement(new juce::XmlElement(*operation.childXml));
+			break;
+		case ConfigPatch::OT_RemoveChild:
+			patchXml->createNewChildElement("RemoveChild")->setAttribute("child", operation.childTagName);
+			break;
+		default:
+			jassertfalse;
+			break;
+		}
+	}
+
+	return patchXml;
+}
+
+/**
+ * Deserializes a patch from a delta journal record written by createConfigPatchXml.
+ * @param patchXml	The <Patch> record element.
+ * @return	The patch, or nullptr if the record is malformed.
+ */
+std::unique_ptr<AppConfigurationBase::ConfigPatch> AppConfigurationBase::createConfigPatchFromXml(const juce::XmlElement& patchXml)
+{
+	auto sectionTagName = patchXml.getStringAttribute("section");
+	if (sectionTagName.isEmpty())
+		return nullptr;
+
+	auto patch = std::make_unique<ConfigPatch>(sectionTagName, patchXml.getStringAttribute("key"), patchXml.getIntAttribute("keyValue"));
+	for (auto operationXml : patchXml.getChildIterator())
+	{
+		if (operationXml->hasTagName("SetAttribute"))
+			patch->setAttribute(operationXml->getStringAttribute("name"), operationXml->getStringAttribute("value"));
+		else if (operationXml->hasTagName("RemoveAttribute"))
+			patch->removeAttribute(operationXml->getStringAttribute("name"));
+		else if (operationXml->hasTagName("SetChildAttribute"))
+			patch->setChildAttribute(operationXml->getStringAttribute("child"), operationXml->getStringAttribute("name"), operationXml->getStringAttribute("value"));
+		else if (operationXml->hasTagName("ReplaceChild") && operationXml->getFirstChildElement() != nullptr)
+			patch->replaceChild(std::make_unique<juce::XmlElement>(*operationXml->getFirstChildElement()));
+		else if (operationXml->hasTagName("RemoveChild"))
+			patch->removeChild(operationXml->getStringAttribute("child"));
+		else
+			return nullptr;
+	}
+
+	return patch;
+}
+
+/**
+ * Writes the given xml as config file text to the stream. If sections of the configuration
+ * were not parsed yet in lazy parsing mode, their text is written verbatim after the parsed ones.
+ * @param stream			The stream to write to.
+ * @param xml				The xml tree to write.
+ * @param unparsedSections	The sections to write verbatim.
+ */
+void AppConfigurationBase::writeConfigXml(juce::OutputStream& stream, const juce::XmlElement& xml, const std::vector<UnparsedSection>& unparsedSections)
+{
+	if (unparsedSections.empty())
+	{
+		xml.writeTo(stream);
+		return;
+	}
+
+	auto rootShell = juce::XmlElement(xml.getTagName());
+	for (int i = 0; i < xml.getNumAttributes(); ++i)
+		rootShell.setAttribute(xml.getAttributeName(i), xml.getAttributeValue(i));
+	auto rootStartTag = rootShell.toString(juce::XmlElement::TextFormat().singleLine().withoutHeader()).trimEnd();
+
+	auto newLine = "\r\n";
+	stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << newLine << newLine;
+	stream << rootStartTag.dropLastCharacters(2) << ">" << newLine;
+	for (auto childElement : xml.getChildIterator())
+		childElement->writeTo(stream, juce::XmlElement::TextFormat().withoutHeader());
+	for (auto const& unparsedSection : unparsedSections)
+		stream << unparsedSection.text << newLine;
+	stream << "</" << xml.getTagName() << ">" << newLine;
+}
+
+/**
+ * Writes the given snapshot as config file text to the stream, one section after another,
+ * without building the text or a copy of the tree in memory. Sections that were not parsed
+ * yet in lazy parsing mode are written verbatim.
+ * @param stream	The stream to write to.
+ * @param snapshot	The snapshot to write.
+ */
+void AppConfigurationBase::writeConfigSnapshot(juce::OutputStream& stream, const ConfigSnapshot& snapshot)
+{
+	auto rootStartTag = snapshot.m_root->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader()).trimEnd();
+
+	auto newLine = "\r\n";
+	stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << newLine << newLine;
+	stream << rootStartTag.dropLastCharacters(2) << ">" << newLine;
+	for (auto const& section : snapshot.m_sections)
+	{
+		if (auto sectionXml = section.getParsedXml())
+			sectionXml->writeTo(stream, juce::XmlElement::TextFormat().withoutHeader());
+		else
+			stream << section.unparsedText << newLine;
+	}
+	stream << "</" << snapshot.m_root->getTagName() << ">" << newLine;
+}
+
+/**
+ * Parses the sections with the given tag name from the list of unparsed sections
+ * and adds them as children to the given target xml.
+ * @param targetXml			The xml to add the parsed sections to.
+ * @param unparsedSections	The list of unparsed sections, parsed ones are removed from it.
+ * @param tagName			The tag name of the sections to parse. All sections are parsed if empty.
+ * @return	True if all matching sections were parsed successfully.
+ */
+bool AppConfigurationBase::parseUnparsedSections(juce::XmlElement& targetXml, std::vector<UnparsedSection>& unparsedSections, juce::StringRef tagName)
+{
+	auto success = true;
+	for (auto iter = unparsedSections.begin(); iter != unparsedSections.end();)
+	{
+		if (tagName.isEmpty() || iter->tagName == tagName)
+		{
+			if (auto sectionXml = juce::parseXML(iter->text))
+				targetXml.addChildElement(sectionXml.release());
+			else
+				success = false;
+
+			iter = unparsedSections.erase(iter);
+		}
+		else
+			iter++;
+	}
+
+	return success;
+}
+
+/**
+ * Gets the most recently published, immutable snapshot of the configuration.
+ * This is safe to be called from any thread, without copying or locking.
+ * Snapshots are published when changes are flushed, on reset and on initialization.
+ * @return	The current snapshot, nullptr if the configuration is not initialized.
+ */
+std::shared_ptr<const AppConfigurationBase::ConfigSnapshot> AppConfigurationBase::getConfigSnapshot() const
+{
+	return std::atomic_load(&m_publishedSnapshot);
+}
+
+/**
+ * Convenience accessor to a section of the current snapshot, safe to be called from any thread.
+ * @param tagName	The tag name of the section to get.
+ * @return	The immutable section, nullptr if no such section exists.
+ */
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::getConfigStateSnapshot(juce::StringRef tagName) const
+{
+	auto snapshot = getConfigSnapshot();
+	if (!snapshot)
+		return nullptr;
+
+	return snapshot->getSection(tagName);
+}
+
+/**
+ * Publishes the current state of m_xml as new immutable snapshot. Sections that did not change
+ * since the previous snapshot are shared with it, only staged sections are cloned.
+ * Derived classes that modify m_xml directly should call this afterwards, with rootChanged set
+ * if root attributes or children were changed other than through setConfigState. Otherwise the
+ * changes are only found by flush, which verifies the hashes of all unstaged sections.
+ * Within a transaction, publishing is deferred until the outermost transaction is committed.
+ * @param rootChanged	True to rebuild the root element and all sections from m_xml.
+ */
+void AppConfigurationBase::publishConfigSnapshot(bool rootChanged)
+{
+	if (!m_xml)
+		return;
+
+	m_snapshotRootPublishRequired |= rootChanged;
+	if (isInTransaction())
+		return;
+
+	auto previousSnapshot = getConfigSnapshot();
+	auto snapshot = buildConfigSnapshot();
+	if (snapshot != previousSnapshot)
+	{
+		std::atomic_store(&m_publishedSnapshot, snapshot);
+		m_snapshotGeneration.fetch_add(1, std::memory_order_release);
+		recordUndoStep(previousSnapshot, snapshot);
+	}
+}
+
+/**
+ * Provides a counter that is incremented with every published change of the configuration snapshot.
+ * Used by TypedValue to recognize outdated cached values with a single atomic load.
+ * @return	The current snapshot generation.
+ */
+juce::uint64 AppConfigurationBase::getSnapshotGeneration() const
+{
+	return m_snapshotGeneration.load(std::memory_order_acquire);
+}
+
+/**
+ * Writes the values set via TypedValue since the last flush into their sections of m_xml.
+ * Called by flush on the message thread, so the values are persisted and published along with
+ * all other changes. The values may be set on other threads concurrently.
+ */
+void AppConfigurationBase::writeBackTypedValues()
+{
+	if (!m_xml)
+		return;
+
+	std::lock_guard<std::mutex> typedvalueslock(m_typedValuesMutex);
+	if (m_pendingTypedValueWriteBacks.empty() && m_handedOverTypedValueWriteBacks.empty())
+		return;
+
+	std::map<juce::String, juce::XmlElement*> changedSections;
+	auto getChangedSection = [&](const juce::String& tagName) {
+		ensureConfigSectionParsed(tagName);
+
+		auto sectionXml = m_xml->getChildByName(tagName);
+		if (sectionXml == nullptr)
+			sectionXml = m_xml->createNewChildElement(tagName);
+
+		changedSections[tagName] = sectionXml;
+		return sectionXml;
+	};
+
+	for (auto const& handedOverXml : m_handedOverTypedValueWriteBacks)
+	{
+		auto sectionXml = getChangedSection(handedOverXml->getTagName());
+		for (int i = 0; i < handedOverXml->getNumAttributes(); ++i)
+			sectionXml->setAttribute(handedOverXml->getAttributeName(i), handedOverXml->getAttributeValue(i));
+	}
+	m_handedOverTypedValueWriteBacks.clear();
+
+	for (auto typedValue : m_pendingTypedValueWriteBacks)
+	{
+		typedValue->writeBack(*getChangedSection(typedValue->getSectionTagName()));
+		typedValue->m_writeBackPending.store(false, std::memory_order_release);
+	}
+	m_pendingTypedValueWriteBacks.clear();
+
+	auto changes = ConfigChangeSet();
+	for (auto const& changedSection : changedSections)
+	{
+		// the section copy is shared by the snapshot and the delta journal, like in setConfigState
+		auto sharedSectionXml = std::make_shared<const juce::XmlElement>(*changedSection.second);
+		stageConfigSnapshotSection(changedSection.second, sharedSectionXml);
+		invalidateConfigStateIndex(changedSection.first);
+		changes.addChangedPath(changedSection.first);
+
+		if (m_persistenceMode == PM_DeltaJournal && !m_fullWriteRequired)
+			m_pendingDeltas.push_back({ juce::String(), sharedSectionXml, nullptr });
+	}
+
+	addPendingConfigChanges(changes);
+}
+
+/**
+ * Builds an immutable snapshot of the current state of m_xml, sharing all sections that are not
+ * staged with the previously built snapshot. The result becomes the base of the next build.
+ * @return	The snapshot of the current state.
+ */
+std::shared_ptr<const AppConfigurationBase::ConfigSnapshot> AppConfigurationBase::buildConfigSnapshot()
+{
+	if (!m_xml)
+		return nullptr;
+
+	if (m_lastBuiltSnapshot && !m_snapshotPublishRequired && !m_snapshotRootPublishRequired)
+		return m_lastBuiltSnapshot;
+
+	auto previousSnapshot = m_lastBuiltSnapshot;
+	auto snapshot = std::make_shared<ConfigSnapshot>();
+
+	std::unordered_map<const juce::XmlElement*, const ConfigSnapshot::Section*> previousSections;
+	if (previousSnapshot && !m_snapshotRootPublishRequired)
+	{
+		snapshot->m_root = previousSnapshot->m_root;
+		for (auto const& section : previousSnapshot->m_sections)
+			if (section.liveElement != nullptr)
+				previousSections[section.liveElement] = &section;
+	}
+	else
+	{
+		auto root = std::make_shared<juce::XmlElement>(m_xml->getTagName());
+		for (int i = 0; i < m_xml->getNumAttributes(); ++i)
+			root->setAttribute(m_xml->getAttributeName(i), m_xml->getAttributeValue(i));
+		snapshot->m_root = root;
+	}
+
+	snapshot->m_sections.reserve(size_t(m_xml->getNumChildElements()) + m_unparsedSections.size());
+	for (auto childElement : m_xml->getChildIterator())
+	{
+		auto section = ConfigSnapshot::Section();
+		section.liveElement = childElement;
+		section.tagName = childElement->getTagName();
+
+		auto stagedSection = m_stagedSnapshotSections.find(childElement);
+		auto previousSection = previousSections.find(childElement);
+		auto isStaged = stagedSection != m_stagedSnapshotSections.end();
+		auto hasPreviousSection = previousSection != previousSections.end() && previousSection->second->isParsed();
+		if (!isStaged && hasPreviousSection)
+		{
+			section.xml = previousSection->second->xml;
+			section.patchedXml = previousSection->second->patchedXml;
+			section.hashes = previousSection->second->hashes;
+		}
+		else
+		{
+			if (isStaged && !stagedSection->second.patches.empty() && hasPreviousSection)
+				section.patchedXml = createPatchedSectionXml(*previousSection->second, stagedSection->second.patches);
+
+			if (section.patchedXml)
+			{
+				// patched sections share the previous xml and are only cloned when they are first read
+				section.hashes = hashPatchedSection(*childElement, *previousSection->second->hashes, stagedSection->second);
+			}
+			else
+			{
+				if (isStaged && stagedSection->second.xml)
+					section.xml = stagedSection->second.xml;
+				else
+					section.xml = std::make_shared<const juce::XmlElement>(*childElement);
+
+				// only new or changed sections are hashed, unchanged ones share their hashes with the previous snapshot
+				auto hashes = std::make_shared<ConfigSnapshot::SectionHashes>();
+				hashes->hash = hashXml(*section.xml, &hashes->attributesHash, &hashes->childHashes);
+				section.hashes = std::move(hashes);
+			}
+		}
+
+		snapshot->m_sections.push_back(std::move(section));
+	}
+	for (auto& unparsedSection : m_unparsedSections)
+	{
+		if (unparsedSection.textHash == 0)
+			unparsedSection.textHash = hashString(s_fnvOffsetBasis, unparsedSection.text);
+
+		auto section = ConfigSnapshot::Section();
+		section.tagName = unparsedSection.tagName;
+		section.unparsedText = unparsedSection.text;
+		auto hashes = std::make_shared<ConfigSnapshot::SectionHashes>();
+		hashes->hash = unparsedSection.textHash;
+		section.hashes = std::move(hashes);
+		snapshot->m_sections.push_back(std::move(section));
+	}
+
+	snapshot->m_rootAttributesHash = hashAttributes(*snapshot->m_root);
+	snapshot->m_hash = hashString(snapshot->m_rootAttributesHash, snapshot->m_root->getTagName());
+	for (auto const& section : snapshot->m_sections)
+		snapshot->m_hash = hashValue(snapshot->m_hash, section.hashes->hash);
+
+	m_stagedSnapshotSections.clear();
+	m_snapshotPublishRequired = false;
+	m_snapshotRootPublishRequired = false;
+
+	m_lastBuiltSnapshot = std::move(snapshot);
+
+	return m_lastBuiltSnapshot;
+}
+
+/**
+ * Stages the children of m_xml that were changed without being staged, e.g. by derived classes
+ * modifying m_xml directly without calling publishConfigSnapshot. The unstaged children are
+ * verified against the hashes of the last built snapshot, so such changes are published and
+ * written like the baseline full tree copy did, at the cost of hashing, not copying, the tree.
+ * Called by flush before publishing.
+ */
+void AppConfigurationBase::stageUnstagedConfigChanges()
+{
+	if (!m_xml || !m_lastBuiltSnapshot || m_snapshotRootPublishRequired)
+		return; // everything is rebuilt from m_xml anyway
+
+	std::unordered_map<const juce::XmlElement*, const ConfigSnapshot::Section*> previousSections;
+	for (auto const& section : m_lastBuiltSnapshot->m_sections)
+		if (section.liveElement != nullptr)
+			previousSections[section.liveElement] = &section;
+
+	auto changes = ConfigChangeSet();
+	if (m_xml->getTagName() != m_lastBuiltSnapshot->m_root->getTagName() || hashAttributes(*m_xml) != m_lastBuiltSnapshot->m_rootAttributesHash)
+	{
+		m_snapshotRootPublishRequired = true;
+		changes.setFullChange();
+	}
+
+	auto matchedSectionCount = size_t(0);
+	for (auto childElement : m_xml->getChildIterator())
+	{
+		auto previousSection = previousSections.find(childElement);
+		if (previousSection != previousSections.end())
+			matchedSectionCount++;
+		if (m_stagedSnapshotSections.count(childElement) != 0)
+			continue;
+
+		// a new element at the address of a removed one is recognized by its hash as well
+		if (previousSection == previousSections.end() || previousSection->second->hashes->hash != hashXml(*childElement))
+		{
+			stageConfigSnapshotSection(childElement);
+			changes.addChangedPath(childElement->getTagName());
+		}
+	}
+
+	if (matchedSectionCount != previousSections.size())
+	{
+		// children were removed, which the next build recognizes by iterating m_xml
+		m_snapshotPublishRequired = true;
+		changes.setFullChange();
+	}
+
+	if (changes.isEmpty())
+		return;
+
+	// unstaged changes are not covered by journaled deltas
+	m_fullWriteRequired = true;
+	addPendingConfigChanges(changes);
+
+	std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+	m_metrics.unstagedChanges++;
+}
+
+/**
+ * Marks a child of m_xml as changed, to be cloned into the next published snapshot.
+ * @param liveElement	The changed child of m_xml.
+ * @param sectionXml	Optional immutable copy of the child, to be used instead of cloning it.
+ */
+void AppConfigurationBase::stageConfigSnapshotSection(const juce::XmlElement* liveElement, std::shared_ptr<const juce::XmlElement> sectionXml)
+{
+	auto stagedSection = StagedSection();
+	stagedSection.xml = std::move(sectionXml);
+	m_stagedSnapshotSections[liveElement] = std::move(stagedSection);
+	m_snapshotPublishRequired = true;
+}
+
+/**
+ * Marks a child of m_xml as changed by the given patch. Unless the child is staged to be
+ * cloned anyway, the next snapshot shares the previous xml of the section and the patches.
+ * @param liveElement	The patched child of m_xml.
+ * @param patch			The patch that was applied to the child.
+ * @param effect		The effect the patch had on the child.
+ */
+void AppConfigurationBase::stagePatchedConfigSnapshotSection(const juce::XmlElement* liveElement, std::shared_ptr<const ConfigPatch> patch, const ConfigPatchEffect& effect)
+{
+	m_snapshotPublishRequired = true;
+
+	auto existingStagedSection = m_stagedSnapshotSections.find(liveElement);
+	if (existingStagedSection != m_stagedSnapshotSections.end() && existingStagedSection->second.patches.empty())
+	{
+		// the staged copy is outdated by the patch, the live element is cloned instead
+		existingStagedSection->second.xml.reset();
+		return;
+	}
+
+	auto& stagedSection = m_stagedSnapshotSections[liveElement];
+	stagedSection.patches.push_back(std::move(patch));
+	stagedSection.childStructureChanged = stagedSection.childStructureChanged || effect.childStructureChanged;
+	for (auto const& childTagName : effect.changedChildTagNames)
+		stagedSection.changedChildTagNames.addIfNotAlreadyThere(childTagName);
+}
+
+/**
+ * Creates the patched xml of a section for the next snapshot, based on the xml of the
+ * section in the previous snapshot. If the previous section was patched itself and not
+ * read since, its base xml is reused and the patches are chained.
+ * @param previousSection	The section in the previous snapshot.
+ * @param patches			The patches applied to the section since the previous snapshot.
+ * @return	The patched xml, nullptr if too many patches are chained and the section should be cloned instead.
+ */
+std::shared_ptr<const AppConfigurationBase::ConfigSnapshot::PatchedXml> AppConfigurationBase::createPatchedSectionXml(const ConfigSnapshot::Section& previousSection, const std::vector<std::shared_ptr<const ConfigPatch>>& patches)
+{
+	auto baseXml = previousSection.xml;
+	auto chainedPatches = std::vector<std::shared_ptr<const ConfigPatch>>();
+	if (!baseXml && previousSection.patchedXml)
+	{
+		baseXml = previousSection.patchedXml->getXmlIfCreated();
+		if (!baseXml)
+		{
+			baseXml = previousSection.patchedXml->getBaseXml();
+			chainedPatches = previousSection.patchedXml->getPatches();
+		}
+	}
+	chainedPatches.insert(chainedPatches.end(), patches.begin(), patches.end());
+
+	if (!baseXml || chainedPatches.size() > s_maxChainedConfigPatches)
+		return nullptr;
+
+	return std::make_shared<const ConfigSnapshot::PatchedXml>(std::move(baseXml), std::move(chainedPatches));
+}
+
+/**
+ * Hashes a section that was only changed by patches. Unless children were added or removed,
+ * only the attributes and the children that were changed in place are hashed again, the
+ * hashes of the other children are taken from the previous snapshot.
+ * @param sectionXml		The patched section element.
+ * @param previousHashes	The hashes of the section in the previous snapshot.
+ * @param stagedSection		The staged patches of the section.
+ * @return	The hashes of the patched section.
+ */
+std::shared_ptr<const AppConfigurationBase::ConfigSnapshot::SectionHashes> AppConfigurationBase::hashPatchedSection(const juce::XmlElement& sectionXml, const ConfigSnapshot::SectionHashes& previousHashes, const StagedSection& stagedSection)
+{
+	auto hashes = std::make_shared<ConfigSnapshot::SectionHashes>();
+	if (stagedSection.childStructureChanged || previousHashes.childHashes.size() != size_t(sectionXml.getNumChildElements()))
+	{
+		hashes->hash = hashXml(sectionXml, &hashes->attributesHash, &hashes->childHashes);
+		return hashes;
+	}
+
+	hashes->attributesHash = hashAttributes(sectionXml);
+	hashes->childHashes = previousHashes.childHashes;
+	for (auto const& childTagName : stagedSection.changedChildTagNames)
+	{
+		// patches always address the first child with a tag name
+		auto childIndex = size_t(0);
+		for (auto childElement : sectionXml.getChildIterator())
+		{
+			if (childElement->hasTagName(childTagName))
+			{
+				hashes->childHashes[childIndex] = hashXml(*childElement);
+				break;
+			}
+			childIndex++;
+		}
+	}
+
+	hashes->hash = hashString(hashes->attributesHash, sectionXml.getTagName());
+	for (auto childHash : hashes->childHashes)
+		hashes->hash = hashValue(hashes->hash, childHash);
+
+	return hashes;
+}
+
+/**
+ * Merges the given state xml into m_xml, equivalent to mergeConfigState, but using a hash index
+ * of the children keyed by tag name, key attribute name and key attribute value.
+ * This avoids walking and parsing the attributes of all siblings on every keyed update.
+ * Existing children are updated in place, which keeps the indexed element pointers valid.
+ * @param stateXml		The state xml to copy into m_xml.
+ * @param attributeName	Optional name of the attribute identifying the child among others with the same tag name.
+ * @param changes		Optional change set to record the changed paths in.
+ * @return	The merged child element of m_xml, nullptr on failure.
+ */
+juce::XmlElement* AppConfigurationBase::mergeConfigStateIndexed(const juce::XmlElement& stateXml, juce::StringRef attributeName, ConfigChangeSet* changes)
+{
+	if (!m_xml)
+		return nullptr;
+
+	if (attributeName.isEmpty())
+	{
+		invalidateConfigStateIndex(stateXml.getTagName());
+		return mergeConfigState(*m_xml, stateXml, attributeName, changes);
+	}
+
+	auto tagName = stateXml.getTagName();
+	auto keyAttributeName = juce::String(attributeName);
+	auto& index = getConfigStateIndex(tagName, keyAttributeName);
+	auto keyValue = stateXml.getIntAttribute(attributeName);
+
+	// The changed child's attributes may invalidate indices of the same tag name using other key attributes
+	for (auto iter = m_configStateIndex.begin(); iter != m_configStateIndex.end();)
+	{
+		if (iter->first.first == tagName && iter->first.second != keyAttributeName)
+			iter = m_configStateIndex.erase(iter);
+		else
+			iter++;
+	}
+
+	auto existingChildElement = index.find(keyValue);
+	if (existingChildElement != index.end())
+	{
+		if (existingChildElement->second->isEquivalentTo(&stateXml, false))
+			return existingChildElement->second;
+
+		if (changes != nullptr)
+			collectChangedPaths(existingChildElement->second, stateXml, *changes);
+
+		*existingChildElement->second = stateXml;
+		return existingChildElement->second;
+	}
+	else
+	{
+		if (changes != nullptr)
+			collectChangedPaths(nullptr, stateXml, *changes);
+
+		auto newChildElement = new juce::XmlElement(stateXml);
+		m_xml->addChildElement(newChildElement);
+		index[keyValue] = newChildElement;
+		return newChildElement;
+	}
+}
+
+/**
+ * Gets the index of m_xml children with the given tag name, keyed by the int value
+ * of the given attribute. The index is built on first use. As with the linear lookup,
+ * the first child wins if several share the same key value.
+ * @param tagName		The tag name of the indexed children.
+ * @param attributeName	The name of the key attribute.
+ * @return	The index, mapping key values to child elements.
+ */
+std::unordered_map<int, juce::XmlElement*>& AppConfigurationBase::getConfigStateIndex(const juce::String& tagName, const juce::String& attributeName)
+{
+	auto indexKey = std::make_pair(tagName, attributeName);
+	auto existingIndex = m_configStateIndex.find(indexKey);
+	if (existingIndex != m_configStateIndex.end())
+		return existingIndex->second;
+
+	auto& index = m_configStateIndex[indexKey];
+	for (auto childElement = m_xml->getChildByName(tagName); childElement != nullptr; childElement = childElement->getNextElementWithTagName(tagName))
+		index.emplace(childElement->getIntAttribute(attributeName), childElement);
+
+	return index;
+}
+
+/**
+ * Drops the child lookup index used by setConfigState. Derived classes that modify
+ * the children of m_xml directly must call this afterwards.
+ * @param tagName	The tag name to drop the index for. All indices are dropped if empty.
+ */
+void AppConfigurationBase::invalidateConfigStateIndex(juce::StringRef tagName)
+{
+	if (tagName.isEmpty())
+	{
+		m_configStateIndex.clear();
+		return;
+	}
+
+	for (auto iter = m_configStateIndex.begin(); iter != m_configStateIndex.end();)
+	{
+		if (iter->first.first == tagName)
+			iter = m_configStateIndex.erase(iter);
+		else
+			iter++;
+	}
+}
+
+/**
+ * Merges the given state xml into the children of the given target xml.
+ * An existing child with the same tag name (and the same value of the given key attribute,
+ * if one is given) is replaced, otherwise the state is added as new child.
+ * @param targetXml		The xml element to merge into.
+ * @param stateXml		The state xml to copy into the target.
+ * @param attributeName	Optional name of the attribute identifying the child among others with the same tag name.
+ * @param changes		Optional change set to record the changed paths in.
+ * @return	The merged child element of the target xml.
+ */
+juce::XmlElement* AppConfigurationBase::mergeConfigState(juce::XmlElement& targetXml, const juce::XmlElement& stateXml, juce::StringRef attributeName, ConfigChangeSet* changes)
+{
+	juce::XmlElement *existingChildElement = targetXml.getChildByName(stateXml.getTagName());
+	juce::XmlElement* childElement = existingChildElement;
+	while (childElement != nullptr && attributeName.isNotEmpty())
+	{
+		if (childElement->getIntAttribute(attributeName) == stateXml.getIntAttribute(attributeName))
+		{
+			existingChildElement = childElement;
+			break;
+		}
+
+		childElement = childElement->getNextElementWithTagName(stateXml.getTagName());
+	}
+
+	if (!existingChildElement || existingChildElement->getIntAttribute(attributeName) != stateXml.getIntAttribute(attributeName))
+		existingChildElement = nullptr;
+	else if (existingChildElement->isEquivalentTo(&stateXml, false))
+		return existingChildElement;
+
+	if (changes != nullptr)
+		collectChangedPaths(existingChildElement, stateXml, *changes);
+
+	auto mergedElement = new juce::XmlElement(stateXml);
+	if (!existingChildElement)
+		targetXml.addChildElement(mergedElement);
+	else
+		targetXml.replaceChildElement(existingChildElement, mergedElement);
+
+	return mergedElement;
+}
+
+/**
+ * Records the paths that differ between the previous and the new state of a top-level section.
+ * The section's own path is recorded if it is new or its attributes or text changed,
+ * changed direct children are recorded as 'Section/Child' paths.
+ * @param previousXml	The previous state of the section, nullptr if it is new.
+ * @param xml			The new state of the section.
+ * @param changes		The change set to record the changed paths in.
+ */
+void AppConfigurationBase::collectChangedPaths(const juce::XmlElement* previousXml, const juce::XmlElement& xml, ConfigChangeSet& changes,
+	const ConfigSnapshot::SectionHashes* previousHashes, const ConfigSnapshot::SectionHashes* hashes)
+{
+	auto sectionPath = xml.getTagName();
+	if (previousXml == nullptr)
+	{
+		changes.addChangedPath(sectionPath);
+		return;
+	}
+
+	auto useHashes = previousHashes != nullptr && hashes != nullptr;
+	if (useHashes && previousHashes->hash == hashes->hash)
+		return;
+
+	auto attributesChanged = previousXml->getNumAttributes() != xml.getNumAttributes();
+	if (useHashes)
+		attributesChanged = previousHashes->attributesHash != hashes->attributesHash;
+	for (int i = 0; i < xml.getNumAttributes() && !attributesChanged && !useHashes; ++i)
+		attributesChanged = previousXml->getStringAttribute(xml.getAttributeName(i), juce::String()) != xml.getAttributeValue(i)
+			|| !previousXml->hasAttribute(xml.getAttributeName(i));
+	if (attributesChanged)
+		changes.addChangedPath(sectionPath);
+
+	auto previousChildElement = previousXml->getFirstChildElement();
+	auto childElement = xml.getFirstChildElement();
+	for (size_t childIndex = 0; previousChildElement != nullptr || childElement != nullptr; ++childIndex)
+	{
+		auto childUnchanged = false;
+		if (useHashes && childIndex < previousHashes->childHashes.size() && childIndex < hashes->childHashes.size())
+			childUnchanged = previousChildElement != nullptr && childElement != nullptr
+				&& previousHashes->childHashes[childIndex] == hashes->childHashes[childIndex];
+		else if (!useHashes)
+			childUnchanged = previousChildElement != nullptr && childElement != nullptr
+				&& previousChildElement->isEquivalentTo(childElement, false);
+		if (!childUnchanged)
+		{
+			for (auto changedChildElement : { previousChildElement, childElement })
+			{
+				if (changedChildElement == nullptr)
+					continue;
+				else if (changedChildElement->isTextElement())
+					changes.addChangedPath(sectionPath);
+				else
+					changes.addChangedPath(sectionPath + "/" + changedChildElement->getTagName());
+			}
+		}
+
+		previousChildElement = previousChildElement != nullptr ? previousChildElement->getNextElement() : nullptr;
+		childElement = childElement != nullptr ? childElement->getNextElement() : nullptr;
+	}
+}
+
+/**
+ * Records the paths that differ between two snapshots. Sections are matched by tag name and
+ * order of occurrence, only sections and children whose subtree hashes differ are descended into.
+ * A change of the root attributes is recorded as full change.
+ * @param previousSnapshot	The previous state.
+ * @param snapshot			The new state.
+ * @param changes			The change set to record the changed paths in.
+ */
+void AppConfigurationBase::collectSnapshotChanges(const ConfigSnapshot& previousSnapshot, const ConfigSnapshot& snapshot, ConfigChangeSet& changes)
+{
+	if (previousSnapshot.getHash() == snapshot.getHash())
+		return;
+
+	if (previousSnapshot.m_rootAttributesHash != snapshot.m_rootAttributesHash || !previousSnapshot.m_root->hasTagName(snapshot.m_root->getTagName()))
+	{
+		changes.setFullChange();
+		return;
+	}
+
+	std::map<juce::String, std::vector<const ConfigSnapshot::Section*>> previousSectionsByTagName;
+	for (auto const& previousSection : previousSnapshot.m_sections)
+		previousSectionsByTagName[previousSection.tagName].push_back(&previousSection);
+
+	std::map<juce::String, size_t> sectionOccurrences;
+	for (auto const& section : snapshot.m_sections)
+	{
+		auto occurrence = sectionOccurrences[section.tagName]++;
+		auto const& previousSections = previousSectionsByTagName[section.tagName];
+		auto previousSection = occurrence < previousSections.size() ? previousSections[occurrence] : nullptr;
+
+		if (previousSection != nullptr && previousSection->hashes->hash == section.hashes->hash)
+			continue;
+		else if (previousSection != nullptr && previousSection->isParsed() && section.isParsed())
+			collectChangedPaths(previousSection->getParsedXml(), *section.getParsedXml(), changes, previousSection->hashes.get(), section.hashes.get());
+		else
+			changes.addChangedPath(section.tagName);
+	}
+
+	// sections that were removed
+	for (auto const& previousSections : previousSectionsByTagName)
+		if (previousSections.second.size() > sectionOccurrences[previousSections.first])
+			changes.addChangedPath(previousSections.first);
+}
+
+/**
+ * Calculates the FNV-1a hash of an xml subtree, covering tag names, attributes, text and child order.
+ * @param xml				The subtree to hash.
+ * @param attributesHash	Optional target for the hash of the element's own attributes.
+ * @param childHashes		Optional target for the subtree hashes of the element's direct children.
+ * @return	The hash of the subtree.
+ */
+juce::uint64 AppConfigurationBase::hashXml(const juce::XmlElement& xml, juce::uint64* attributesHash, std::vector<juce::uint64>* childHashes)
+{
+	if (xml.isTextElement())
+		return hashString(hashString(s_fnvOffsetBasis, "#text"), xml.getText());
+
+	auto elementAttributesHash = hashAttributes(xml);
+	if (attributesHash != nullptr)
+		*attributesHash = elementAttributesHash;
+
+	auto hash = hashString(elementAttributesHash, xml.getTagName());
+	for (auto childElement = xml.getFirstChildElement(); childElement != nullptr; childElement = childElement->getNextElement())
+	{
+		auto childHash = hashXml(*childElement);
+		if (childHashes != nullptr)
+			childHashes->push_back(childHash);
+		hash = hashValue(hash, childHash);
+	}
+
+	return hash;
+}
+
+//==============================================================================
+const juce::String& AppConfigurationBase::ConfigSnapshot::getRootTagName() const
+{
+	return m_root->getTagName();
+}
+
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::ConfigSnapshot::getRootElement() const
+{
+	return m_root;
+}
+
+int AppConfigurationBase::ConfigSnapshot::getNumSections() const
+{
+	return int(m_sections.size());
+}
+
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::ConfigSnapshot::getSection(juce::StringRef tagName) const
+{
+	for (auto const& section : m_sections)
+		if (section.tagName == tagName)
+			return section.getXml();
+
+	return nullptr;
+}
+
+std::vector<std::shared_ptr<const juce::XmlElement>> AppConfigurationBase::ConfigSnapshot::getSections(juce::StringRef tagName) const
+{
+	auto sections = std::vector<std::shared_ptr<const juce::XmlElement>>();
+	for (auto const& section : m_sections)
+		if (tagName.isEmpty() || section.tagName == tagName)
+			if (auto sectionXml = section.getXml())
+				sections.push_back(sectionXml);
+
+	return sections;
+}
+
+/**
+ * Creates a mutable deep copy of the entire configuration contained in the snapshot.
+ * @return	The configuration root element with all sections.
+ */
+std::unique_ptr<juce::XmlElement> AppConfigurationBase::ConfigSnapshot::createXml() const
+{
+	auto xml = std::make_unique<juce::XmlElement>(*m_root);
+	for (auto const& sectionXml : getSections())
+		xml->addChildElement(new juce::XmlElement(*sectionXml));
+
+	return xml;
+}
+
+/**
+ * Provides a hash of the snapshot's content. Two snapshots with equal content have equal hashes,
+ * sections that were not parsed yet hash differently than their parsed counterparts though.
+ * @return	The hash of the snapshot.
+ */
+juce::uint64 AppConfigurationBase::ConfigSnapshot::getHash() const
+{
+	return m_hash;
+}
+
+/**
+ * Gets the xml of the section. Patched sections are cloned and patched once on the first call.
+ * Sections that were not parsed yet in lazy parsing mode are parsed from their text on every
+ * call, since the snapshot itself is immutable.
+ */
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::ConfigSnapshot::Section::getXml() const
+{
+	if (xml)
+		return xml;
+	if (patchedXml)
+		return patchedXml->getXml();
+
+	return std::shared_ptr<const juce::XmlElement>(juce::parseXML(unparsedText));
+}
+
+/**
+ * Checks if the section is available as xml, i.e. it is not an unparsed section.
+ */
+bool AppConfigurationBase::ConfigSnapshot::Section::isParsed() const
+{
+	return xml || patchedXml;
+}
+
+/**
+ * Gets the xml of a parsed section without taking a reference. The xml stays valid as long
+ * as the section does.
+ * @return	The xml of the section, nullptr for unparsed sections.
+ */
+const juce::XmlElement* AppConfigurationBase::ConfigSnapshot::Section::getParsedXml() const
+{
+	if (xml)
+		return xml.get();
+	if (patchedXml)
+		return patchedXml->getXml().get();
+
+	return nullptr;
+}
+
+//==============================================================================
+AppConfigurationBase::ConfigSnapshot::PatchedXml::PatchedXml(std::shared_ptr<const juce::XmlElement> baseXml, std::vector<std::shared_ptr<const ConfigPatch>> patches)
+	: m_baseXml(std::move(baseXml)), m_patches(std::move(patches))
+{
+}
+
+/**
+ * Gets the patched xml, which is cloned from the base xml and patched on the first call.
+ * This is thread safe, since snapshots are read by the flush thread as well.
+ * @return	The patched xml.
+ */
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::ConfigSnapshot::PatchedXml::getXml() const
+{
+	std::lock_guard<std::mutex> xmlLock(m_xmlMutex);
+	if (!m_xml)
+	{
+		auto xml = std::make_shared<juce::XmlElement>(*m_baseXml);
+		auto effect = ConfigPatchEffect();
+		for (auto const& patch : m_patches)
+			AppConfigurationBase::applyConfigPatchOperations(*xml, *patch, effect);
+		m_xml = std::move(xml);
+	}
+
+	return m_xml;
+}
+
+/**
+ * Gets the patched xml if it was already created by getXml.
+ * @return	The patched xml, nullptr if it was not created yet.
+ */
+std::shared_ptr<const juce::XmlElement> AppConfigurationBase::ConfigSnapshot::PatchedXml::getXmlIfCreated() const
+{
+	std::lock_guard<std::mutex> xmlLock(m_xmlMutex);
+	return m_xml;
+}
+
+const std::shared_ptr<const juce::XmlElement>& AppConfigurationBase::ConfigSnapshot::PatchedXml::getBaseXml() const
+{
+	return m_baseXml;
+}
+
+const std::vector<std::shared_ptr<const AppConfigurationBase::ConfigPatch>>& AppConfigurationBase::ConfigSnapshot::PatchedXml::getPatches() const
+{
+	return m_patches;
+}
+
+//==============================================================================
+AppConfigurationBase::ConfigPatch::ConfigPatch(const juce::String& sectionTagName, const juce::String& keyAttributeName, int keyAttributeValue)
+	: m_sectionTagName(sectionTagName), m_keyAttributeName(keyAttributeName), m_keyAttributeValue(keyAttributeValue)
+{
+}
+
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::setAttribute(const juce::String& name, const juce::String& value)
+{
+	m_operations.push_back({ OT_SetAttribute, juce::String(), name, value, nullptr });
+	return *this;
+}
+
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::setAttribute(const juce::String& name, int value)
+{
+	return setAttribute(name, juce::String(value));
+}
+
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::setAttribute(const juce::String& name, double value)
+{
+	return setAttribute(name, juce::String(value));
+}
+
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::removeAttribute(const juce::String& name)
+{
+	m_operations.push_back({ OT_RemoveAttribute, juce::String(), name, juce::String(), nullptr });
+	return *this;
+}
+
+/**
+ * Sets an attribute of the first direct child of the section with the given tag name,
+ * creating the child if it does not exist yet.
+ * @param childTagName	The tag name of the child.
+ * @param name			The attribute name.
+ * @param value			The attribute value.
+ * @return	This patch, to chain further mutations.
+ */
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::setChildAttribute(const juce::String& childTagName, const juce::String& name, const juce::String& value)
+{
+	m_operations.push_back({ OT_SetChildAttribute, childTagName, name, value, nullptr });
+	return *this;
+}
+
+/**
+ * Replaces the first direct child of the section with the same tag name as the given child,
+ * adding it if no such child exists yet.
+ * @param childXml	The new child.
+ * @return	This patch, to chain further mutations.
+ */
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::replaceChild(std::unique_ptr<juce::XmlElement> childXml)
+{
+	if (childXml)
+		m_operations.push_back({ OT_ReplaceChild, childXml->getTagName(), juce::String(), juce::String(), std::shared_ptr<const juce::XmlElement>(childXml.release()) });
+	return *this;
+}
+
+AppConfigurationBase::ConfigPatch& AppConfigurationBase::ConfigPatch::removeChild(const juce::String& childTagName)
+{
+	m_operations.push_back({ OT_RemoveChild, childTagName, juce::String(), juce::String(), nullptr });
+	return *this;
+}
+
+const juce::String& AppConfigurationBase::ConfigPatch::getSectionTagName() const
+{
+	return m_sectionTagName;
+}
+
+bool AppConfigurationBase::ConfigPatch::isEmpty() const
+{
+	return m_operations.empty();
+}
+
+//==============================================================================
+void AppConfigurationBase::ConfigChangeSet::addChangedPath(const juce::String& path)
+{
+	if (!m_fullChange)
+		m_changedPaths.addIfNotAlreadyThere(path);
+}
+
+void AppConfigurationBase::ConfigChangeSet::setFullChange()
+{
+	m_fullChange = true;
+	m_changedPaths.clear();
+}
+
+void AppConfigurationBase::ConfigChangeSet::merge(const ConfigChangeSet& other)
+{
+	if (other.isFullChange())
+		setFullChange();
+	else
+		for (auto const& path : other.getChangedPaths())
+			addChangedPath(path);
+}
+
+void AppConfigurationBase::ConfigChangeSet::clear()
+{
+	m_fullChange = false;
+	m_changedPaths.clear();
+}
+
+bool AppConfigurationBase::ConfigChangeSet::isEmpty() const
+{
+	return !m_fullChange && m_changedPaths.isEmpty();
+}
+
+bool AppConfigurationBase::ConfigChangeSet::isFullChange() const
+{
+	return m_fullChange;
+}
+
+const juce::StringArray& AppConfigurationBase::ConfigChangeSet::getChangedPaths() const
+{
+	return m_changedPaths;
+}
+
+/**
+ * Checks if the given path is affected by the changes, i.e. if the path itself, one of
+ * its descendants or one of its ancestors as a whole was changed.
+ * @param path	The slash separated path to check, e.g. 'Section' or 'Section/Child'.
+ * @return	True if the path is affected.
+ */
+bool AppConfigurationBase::ConfigChangeSet::affectsPath(const juce::String& path) const
+{
+	if (m_fullChange)
+		return true;
+
+	for (auto const& changedPath : m_changedPaths)
+		if (changedPath == path || changedPath.startsWith(path + "/") || path.startsWith(changedPath + "/"))
+			return true;
+
+	return false;
+}
+
+bool AppConfigurationBase::ConfigChangeSet::affectsAnyPath(const juce::StringArray& paths) const
+{
+	for (auto const& path : paths)
+		if (affectsPath(path))
+			return true;
+
+	return false;
+}
+
+//==============================================================================
+void AppConfigurationBase::Metrics::Histogram::add(juce::int64 value)
+{
+	value = juce::jmax(juce::int64(0), value);
+
+	m_min = m_count == 0 ? value : juce::jmin(m_min, value);
+	m_max = m_count == 0 ? value : juce::jmax(m_max, value);
+	m_count++;
+	m_sum += value;
+
+	auto bucket = 0;
+	while (bucket < s_numBuckets - 1 && value >= (juce::int64(1) << bucket))
+		bucket++;
+	m_buckets[size_t(bucket)]++;
+}
+
+juce::int64 AppConfigurationBase::Metrics::Histogram::getCount() const
+{
+	return m_count;
+}
+
+juce::int64 AppConfigurationBase::Metrics::Histogram::getSum() const
+{
+	return m_sum;
+}
+
+juce::int64 AppConfigurationBase::Metrics::Histogram::getMin() const
+{
+	return m_min;
+}
+
+juce::int64 AppConfigurationBase::Metrics::Histogram::getMax() const
+{
+	return m_max;
+}
+
+double AppConfigurationBase::Metrics::Histogram::getMean() const
+{
+	return m_count > 0 ? double(m_sum) / double(m_count) : 0.0;
+}
+
+/**
+ * Estimates a percentile of the recorded values from the power of two buckets.
+ * @param percentile	The percentile to estimate, in the range 0 to 100.
+ * @return	The upper bound of the bucket containing the percentile, limited to the maximum value recorded.
+ */
+juce::int64 AppConfigurationBase::Metrics::Histogram::getPercentile(double percentile) const
+{
+	if (m_count == 0)
+		return 0;
+
+	auto rank = juce::int64(std::ceil(juce::jlimit(0.0, 100.0, percentile) / 100.0 * double(m_count)));
+	auto cumulativeCount = juce::int64(0);
+	for (int bucket = 0; bucket < s_numBuckets; ++bucket)
+	{
+		cumulativeCount += m_buckets[size_t(bucket)];
+		if (cumulativeCount >= rank)
+			return juce::jlimit(m_min, m_max, (juce::int64(1) << bucket) - 1);
+	}
+
+	return m_max;
+}
+
+juce::String AppConfigurationBase::Metrics::Histogram::toString() const
+{
+	juce::String rv;
+	rv << "count " << m_count << ", mean " << juce::String(getMean(), 1) << ", min " << m_min << ", max " << m_max
+		<< ", p50 " << getPercentile(50.0) << ", p99 " << getPercentile(99.0);
+	return rv;
+}
+
+juce::String AppConfigurationBase::Metrics::toString() const
+{
+	juce::String rv;
+	rv << "flushRequests: " << flushRequests << ", skippedFlushes: " << skippedFlushes << ", fullWrites: " << fullWrites << ", deltaJournalAppends: " << deltaJournalAppends
+		<< ", failedWrites: " << failedWrites << ", bytesWritten: " << bytesWritten << ", binarySnapshotLoads: " << binarySnapshotLoads
+		<< ", replayedDeltas: " << replayedDeltas << ", unstagedChanges: " << unstagedChanges << "\n";
+	rv << "loadTimeUs: " << loadTimeUs.toString() << "\n";
+	rv << "bytesPerWrite: " << bytesPerWrite.toString() << "\n";
+	rv << "diskWriteTimeUs: " << diskWriteTimeUs.toString() << "\n";
+	rv << "flushQueueLatencyUs: " << flushQueueLatencyUs.toString() << "\n";
+	rv << "deepCopyTimeUs: " << deepCopyTimeUs.toString() << "\n";
+	rv << "dumperTimeUs: " << dumperTimeUs.toString() << "\n";
+	rv << "watcherTimeUs: " << watcherTimeUs.toString() << "\n";
+	return rv;
+}
+
+/**
+ * Provides a copy of the metrics collected since initialization or the last reset.
+ * This is safe to be called from any thread.
+ * @return	The current metrics.
+ */
+AppConfigurationBase::Metrics AppConfigurationBase::getMetrics() const
+{
+	std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+	return m_metrics;
+}
+
+void AppConfigurationBase::resetMetrics()
+{
+	std::lock_guard<std::mutex> metricslock(m_metricsMutex);
+	m_metrics = Metrics();
+}
+
+/**
+ * Dumps the current metrics in human readable form, either to the debug output or appended to a file.
+ * @param file	The file to append the metrics to, the debug output is used if this is not set.
+ * @return	True on success.
+ */
+bool AppConfigurationBase::dumpMetrics(const juce::File& file) const
+{
+	auto metricsText = juce::Time::getCurrentTime().toISO8601(true) + " " + m_configName + "\n" + getMetrics().toString();
+
+	if (file == juce::File())
+	{
+		DBG(metricsText);
+		return true;
+	}
+
+	return file.appendText(metricsText);
+}
+
+//==============================================================================
+bool AppConfigurationBase::flushToDisk()
+{
+	return flush(false);
+}
+
+/**
+ * Flushes the configuration like flushToDisk, but returns a future that becomes ready as soon as
+ * the flush thread has written this flush generation to disk. This allows e.g. shutdown or
+ * 'save now' code paths to block until the changes are durable.
+ * @return	The future result, true if the changes were written successfully, false if writing
+ *			failed or no write was requested, since flushing is disabled or deferred by a transaction.
+ */
+std::shared_future<bool> AppConfigurationBase::flushToDiskAsync()
+{
+	auto completion = std::promise<bool>();
+	auto result = completion.get_future().share();
+
+	flush(false, &completion);
+
+	return result;
+}
+
+/**
+ * Begins a transaction. Until the outermost transaction is committed, configuration dumps, flushes,
+ * watcher updates and snapshot publishing are deferred, so that a batch of changes becomes visible
+ * at once. Transactions can be nested, each one creates a savepoint that can be rolled back to.
+ * Every call must be paired with commitTransaction or rollbackTransaction, preferably by using
+ * ScopedConfigTransaction.
+ */
+void AppConfigurationBase::beginTransaction()
+{
+	jassert(m_xml); // transactions require an initialized configuration
+
+	auto savepoint = TransactionSavepoint();
+	savepoint.snapshot = buildConfigSnapshot();
+	savepoint.pendingConfigChanges = m_pendingConfigChanges;
+	savepoint.pendingDeltaCount = m_pendingDeltas.size();
+	savepoint.fullWriteRequired = m_fullWriteRequired;
+
+	m_transactionSavepoints.push_back(std::move(savepoint));
+}
+
+/**
+ * Commits the innermost transaction. For a nested transaction, its deferred requests are handed on
+ * to the enclosing one. For the outermost transaction, the deferred dump or flush is performed and
+ * watchers are updated, if the transaction changed the configuration or requested to do so.
+ * @return	True on success, false if no transaction was active.
+ */
+bool AppConfigurationBase::commitTransaction()
+{
+	jassert(isInTransaction());
+	if (!isInTransaction())
+		return false;
+
+	auto savepoint = std::move(m_transactionSavepoints.back());
+	m_transactionSavepoints.pop_back();
+
+	if (isInTransaction())
+	{
+		auto& enclosingSavepoint = m_transactionSavepoints.back();
+		enclosingSavepoint.dumpDeferred |= savepoint.dumpDeferred;
+		enclosingSavepoint.flushDeferred |= savepoint.flushDeferred;
+		enclosingSavepoint.watcherUpdateDeferred |= savepoint.watcherUpdateDeferred;
+		return true;
+	}
+
+	auto changed = m_snapshotPublishRequired || m_snapshotRootPublishRequired || !m_pendingConfigChanges.isEmpty();
+	if (savepoint.dumpDeferred)
+		triggerConfigurationDump(savepoint.watcherUpdateDeferred || changed);
+	else if (savepoint.flushDeferred || changed)
+		return flush(savepoint.watcherUpdateDeferred || changed);
+	else if (savepoint.watcherUpdateDeferred)
+		triggerWatcherUpdate();
+
+	return true;
+}
+
+/**
+ * Rolls back the innermost transaction, restoring the configuration to the state it had when
+ * the transaction was begun. Dumps, flushes and watcher updates deferred by it are discarded.
+ */
+void AppConfigurationBase::rollbackTransaction()
+{
+	jassert(isInTransaction());
+	if (!isInTransaction())
+		return;
+
+	auto savepoint = std::move(m_transactionSavepoints.back());
+	m_transactionSavepoints.pop_back();
+
+	// only the sections the transaction changed are restored, all others stay shared with the current snapshot
+	restoreConfigSnapshotSections(*savepoint.snapshot);
+
+	m_pendingConfigChanges = std::move(savepoint.pendingConfigChanges);
+	m_pendingDeltas.resize(juce::jmin(m_pendingDeltas.size(), savepoint.pendingDeltaCount));
+	m_fullWriteRequired = savepoint.fullWriteRequired;
+}
+
+bool AppConfigurationBase::isInTransaction() const
+{
+	return !m_transactionSavepoints.empty();
+}
+
+int AppConfigurationBase::getTransactionDepth() const
+{
+	return int(m_transactionSavepoints.size());
+}
+
+/**
+ * Sets the number of configuration states kept for undo. Every published change of the
+ * configuration is an undo step, i.e. a dump, flush or committed transaction. Since the states
+ * are immutable snapshots sharing all unchanged sections, a step only costs the changed sections.
+ * @param maxSteps	The maximum number of undo steps, 0 to disable the undo history.
+ */
+void AppConfigurationBase::SetUndoHistoryLimit(int maxSteps)
+{
+	m_undoHistoryLimit = juce::jmax(0, maxSteps);
+	if (m_undoHistory.size() > size_t(m_undoHistoryLimit))
+		m_undoHistory.erase(m_undoHistory.begin(), m_undoHistory.end() - m_undoHistoryLimit);
+	if (m_undoHistoryLimit == 0)
+		m_redoHistory.clear();
+}
+
+int AppConfigurationBase::GetUndoHistoryLimit() const
+{
+	return m_undoHistoryLimit;
+}
+
+bool AppConfigurationBase::canUndo() const
+{
+	return !m_undoHistory.empty();
+}
+
+bool AppConfigurationBase::canRedo() const
+{
+	return !m_redoHistory.empty();
+}
+
+/**
+ * Restores the configuration state before the last published change. Changes that were
+ * not published yet are published first and undone as well. Only the sections that differ
+ * are restored and only the watchers affected by them are notified.
+ * @return	True if a state was restored, false if there is nothing to undo or a transaction is open.
+ */
+bool AppConfigurationBase::undo()
+{
+	if (isInTransaction())
+	{
+		jassertfalse; // undo within a transaction is not supported
+		return false;
+	}
+
+	publishConfigSnapshot();
+	if (m_undoHistory.empty())
+		return false;
+
+	auto currentSnapshot = getConfigSnapshot();
+	auto undoSnapshot = m_undoHistory.back();
+	m_undoHistory.pop_back();
+	if (!restoreConfigSnapshot(undoSnapshot))
+		return false;
+
+	m_redoHistory.push_back(currentSnapshot);
+
+	return true;
+}
+
+/**
+ * Restores the configuration state that was undone last. Any change published after undoing
+ * discards the redo history.
+ * @return	True if a state was restored, false if there is nothing to redo or a transaction is open.
+ */
+bool AppConfigurationBase::redo()
+{
+	if (isInTransaction())
+	{
+		jassertfalse; // redo within a transaction is not supported
+		return false;
+	}
+
+	publishConfigSnapshot();
+	if (m_redoHistory.empty())
+		return false;
+
+	auto currentSnapshot = getConfigSnapshot();
+	auto redoSnapshot = m_redoHistory.back();
+	m_redoHistory.pop_back();
+	if (!restoreConfigSnapshot(redoSnapshot))
+		return false;
+
+	m_undoHistory.push_back(currentSnapshot);
+
+	return true;
+}
+
+void AppConfigurationBase::clearUndoHistory()
+{
+	m_undoHistory.clear();
+	m_redoHistory.clear();
+}
+
+/**
+ * Records the previously published snapshot as undo step, if the newly published one differs in content.
+ * @param previousSnapshot	The snapshot published before.
+ * @param snapshot			The snapshot published now.
+ */
+void AppConfigurationBase::recordUndoStep(const std::shared_ptr<const ConfigSnapshot>& previousSnapshot, const std::shared_ptr<const ConfigSnapshot>& snapshot)
+{
+	if (m_undoHistoryLimit == 0 || m_restoringConfigSnapshot || !previousSnapshot || !snapshot || previousSnapshot->getHash() == snapshot->getHash())
+		return;
+
+	m_undoHistory.push_back(previousSnapshot);
+	if (m_undoHistory.size() > size_t(m_undoHistoryLimit))
+		m_undoHistory.erase(m_undoHistory.begin());
+	m_redoHistory.clear();
+}
+
+/**
+ * Restores the root attributes and sections of the given snapshot into m_xml. Sections are matched
+ * by tag name and order of occurrence. Only the sections whose hashes differ are replaced, added or
+ * removed, the restored sections share their immutable xml with the given snapshot and are staged,
+ * so the next build maps them to their new live elements. Lazily parsed sections are only parsed
+ * if sections with their tag name differ.
+ * @param snapshot	The snapshot to restore.
+ * @return	The snapshot of the state before restoring, nullptr if the configuration is not initialized.
+ */
+std::shared_ptr<const AppConfigurationBase::ConfigSnapshot> AppConfigurationBase::restoreConfigSnapshotSections(const ConfigSnapshot& snapshot)
+{
+	auto currentSnapshot = buildConfigSnapshot();
+	if (!currentSnapshot)
+		return nullptr;
+
+	if (currentSnapshot->m_rootAttributesHash != snapshot.m_rootAttributesHash)
+	{
+		m_xml->removeAllAttributes();
+		for (int i = 0; i < snapshot.m_root->getNumAttributes(); ++i)
+			m_xml->setAttribute(snapshot.m_root->getAttributeName(i), snapshot.m_root->getAttributeValue(i));
+		m_snapshotRootPublishRequired = true;
+	}
+
+	std::map<juce::String, std::vector<const ConfigSnapshot::Section*>> currentSectionsByTagName;
+	for (auto const& section : currentSnapshot->m_sections)
+		currentSectionsByTagName[section.tagName].push_back(&section);
+	std::map<juce::String, std::vector<const ConfigSnapshot::Section*>> sectionsByTagName;
+	for (auto const& section : snapshot.m_sections)
+		sectionsByTagName[section.tagName].push_back(&section);
+	for (auto const& currentSections : currentSectionsByTagName)
+		sectionsByTagName[currentSections.first]; // sections that do not exist in the restored state are removed
+
+	for (auto const& tagSections : sectionsByTagName)
+	{
+		auto const& tagName = tagSections.first;
+		auto const& sections = tagSections.second;
+		auto const& currentSections = currentSectionsByTagName[tagName];
+
+		auto unchanged = sections.size() == currentSections.size();
+		for (size_t i = 0; unchanged && i < sections.size(); ++i)
+			unchanged = sections[i]->hashes == currentSections[i]->hashes || sections[i]->hashes->hash == currentSections[i]->hashes->hash;
+		if (unchanged)
+			continue;
+
+		ensureConfigSectionParsed(tagName);
+
+		std::vector<juce::XmlElement*> liveSections;
+		for (auto childElement : m_xml->getChildIterator())
+			if (childElement->hasTagName(tagName))
+				liveSections.push_back(childElement);
+
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			auto liveElement = i < liveSections.size() ? liveSections[i] : nullptr;
+			auto bothParsed = i < currentSections.size() && currentSections[i]->isParsed() && sections[i]->isParsed();
+			if (liveElement != nullptr && bothParsed && currentSections[i]->hashes->hash == sections[i]->hashes->hash)
+				continue;
+
+			auto sectionXml = sections[i]->getXml();
+			if (!sectionXml)
+				continue;
+
+			// parsed and unparsed sections hash differently, these are compared by the hash of their xml
+			if (liveElement != nullptr && !bothParsed && hashXml(*liveElement) == hashXml(*sectionXml))
+				continue;
+
+			auto restoredElement = new juce::XmlElement(*sectionXml);
+			if (liveElement != nullptr)
+				m_xml->replaceChildElement(liveElement, restoredElement);
+			else
+				m_xml->addChildElement(restoredElement);
+			stageConfigSnapshotSection(restoredElement, sectionXml);
+		}
+
+		for (auto i = sections.size(); i < liveSections.size(); ++i)
+		{
+			m_xml->removeChildElement(liveSections[i], true);
+			m_snapshotPublishRequired = true;
+		}
+
+		invalidateConfigStateIndex(tagName);
+	}
+
+	return currentSnapshot;
+}
+
+/**
+ * Restores the state of the given snapshot into m_xml, see restoreConfigSnapshotSections. Only
+ * differing sections are parsed, replaced, added or removed. A change of the root attributes
+ * requires all sections to be republished though. The result is flushed and the affected
+ * watchers are notified.
+ * @param snapshot	The snapshot to restore.
+ * @return	True on success.
+ */
+bool AppConfigurationBase::restoreConfigSnapshot(const std::shared_ptr<const ConfigSnapshot>& snapshot)
+{
+	if (!snapshot)
+		return false;
+
+	auto currentSnapshot = restoreConfigSnapshotSections(*snapshot);
+	if (!currentSnapshot)
+		return false;
+
+	auto restoredSnapshot = buildConfigSnapshot();
+	auto changes = ConfigChangeSet();
+	collectSnapshotChanges(*currentSnapshot, *restoredSnapshot, changes);
+	if (changes.isEmpty())
+		return true;
+
+	// journaled deltas cannot express removed sections or sections that are not identified by a key attribute
+	if (m_persistenceMode == PM_DeltaJournal)
+		m_fullWriteRequired = true;
+
+	addPendingConfigChanges(changes);
+
+	m_restoringConfigSnapshot = true;
+	publishConfigSnapshot();
+	m_restoringConfigSnapshot = false;
+
+	// the Dumpers are not involved, since they would overwrite the restored state with their current one
+	return flush(true);
+}
+
+//==============================================================================
+AppConfigurationBase::TypedValueBase::TypedValueBase(AppConfigurationBase& config)
+	: m_config(&config)
+{
+	std::lock_guard<std::mutex> typedvalueslock(config.m_typedValuesMutex);
+	config.m_typedValues.push_back(this);
+}
+
+AppConfigurationBase::TypedValueBase::~TypedValueBase()
+{
+	auto writeBackLock = lockWriteBacks();
+	if (m_config == nullptr)
+		return;
+
+	auto& typedValues = m_config->m_typedValues;
+	typedValues.erase(std::remove(typedValues.begin(), typedValues.end(), this), typedValues.end());
+	auto& pendingWriteBacks = m_config->m_pendingTypedValueWriteBacks;
+	pendingWriteBacks.erase(std::remove(pendingWriteBacks.begin(), pendingWriteBacks.end(), this), pendingWriteBacks.end());
+}
+
+/**
+ * Locks the write backs of the configuration, which must be held while changing a value
+ * that might be written back concurrently.
+ * @return	The lock, which does not own a mutex if the configuration was already destroyed.
+ */
+std::unique_lock<std::mutex> AppConfigurationBase::TypedValueBase::lockWriteBacks()
+{
+	if (m_config == nullptr)
+		return std::unique_lock<std::mutex>();
+
+	return std::unique_lock<std::mutex>(m_config->m_typedValuesMutex);
+}
+
+/**
+ * Registers this value to be written to the configuration with the next flush.
+ * The lock returned by lockWriteBacks must be held.
+ */
+void AppConfigurationBase::TypedValueBase::setWriteBackPending()
+{
+	if (m_config == nullptr || isWriteBackPending())
+		return;
+
+	m_writeBackPending.store(true, std::memory_order_release);
+	m_config->m_pendingTypedValueWriteBacks.push_back(this);
+}
+
+/**
+ * Hands a pending write back over to the configuration, to be written with the next flush
+ * although this value is destroyed. Must be called by the destructor of the derived class,
+ * while writeBack is still available.
+ */
+void AppConfigurationBase::TypedValueBase::handOverWriteBack()
+{
+	auto writeBackLock = lockWriteBacks();
+	if (m_config == nullptr || !isWriteBackPending())
+		return;
+
+	auto sectionXml = std::make_unique<juce::XmlElement>(getSectionTagName());
+	writeBack(*sectionXml);
+	m_config->m_handedOverTypedValueWriteBacks.push_back(std::move(sectionXml));
+
+	auto& pendingWriteBacks = m_config->m_pendingTypedValueWriteBacks;
+	pendingWriteBacks.erase(std::remove(pendingWriteBacks.begin(), pendingWriteBacks.end(), this), pendingWriteBacks.end());
+	m_writeBackPending.store(false, std::memory_order_release);
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, int& value)
+{
+	value = xml.getIntAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, juce::int64& value)
+{
+	value = xml.getStringAttribute(name, juce::String(value)).getLargeIntValue();
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, bool& value)
+{
+	value = xml.getBoolAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, float& value)
+{
+	value = float(xml.getDoubleAttribute(name, value));
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, double& value)
+{
+	value = xml.getDoubleAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::readAttribute(const juce::XmlElement& xml, const char* name, juce::String& value)
+{
+	value = xml.getStringAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, int value)
+{
+	xml.setAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, juce::int64 value)
+{
+	xml.setAttribute(name, juce::String(value));
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, bool value)
+{
+	xml.setAttribute(name, value ? 1 : 0);
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, float value)
+{
+	xml.setAttribute(name, double(value));
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, double value)
+{
+	xml.setAttribute(name, value);
+}
+
+void AppConfigurationBase::TypedValueBase::writeAttribute(juce::XmlElement& xml, const char* name, const juce::String& value)
+{
+	xml.setAttribute(name, value);
+}
+
+//==============================================================================
+AppConfigurationBase::ScopedConfigTransaction::ScopedConfigTransaction(AppConfigurationBase& config)
+	: m_config(config)
+{
+	m_config.beginTransaction();
+	m_depth = m_config.getTransactionDepth();
+}
+
+/**
+ * Rolls the transaction back, if it was neither committed nor rolled back explicitly.
+ */
+AppConfigurationBase::ScopedConfigTransaction::~ScopedConfigTransaction()
+{
+	if (!m_finished)
+		rollback();
+}
+
+bool AppConfigurationBase::ScopedConfigTransaction::commit()
+{
+	jassert(!m_finished && m_config.getTransactionDepth() == m_depth); // nested transactions must be finished in reverse order
+	if (m_finished)
+		return false;
+
+	m_finished = true;
+	return m_config.commitTransaction();
+}
+
+void AppConfigurationBase::ScopedConfigTransaction::rollback()
+{
+	jassert(!m_finished && m_config.getTransactionDepth() == m_depth); // nested transactions must be finished in reverse order
+	if (m_finished)
+		return;
+
+	m_finished = true;
+	m_config.rollbackTransaction();
+}
+
+/**
+ * Selects how configuration changes are persisted. In PM_FullSnapshot mode, every flush
+ * rewrites the entire config file. In PM_DeltaJournal mode, the states set via setConfigState
+ * are appended to a journal file instead and folded into a full snapshot in the background,
+ * as soon as the journal exceeds the given size. Must be called before InitializeBase.
+ * @param mode									The persistence mode to use.
+ * @param deltaJournalCompactionThresholdBytes	The journal size that triggers compaction in PM_DeltaJournal mode.
+ */
+void AppConfigurationBase::SetPersistenceMode(PersistenceMode mode, juce::int64 deltaJournalCompactionThresholdBytes)
+{
+	jassert(!m_fileFlushThread); // changing the persistence mode after initialization is not supported
+
+	m_persistenceMode = mode;
+	m_deltaJournalCompactionThreshold = deltaJournalCompactionThresholdBytes;
+}
+
+AppConfigurationBase::PersistenceMode AppConfigurationBase::GetPersistenceMode() const
+{
+	return m_persistenceMode;
+}
+
+/**
+ * Enables maintaining a binary snapshot of the configuration next to the xml config file.
+ * On startup the snapshot is loaded instead of parsing the xml, as long as it is
+ * not stale. The xml file remains the human-editable interchange format.
+ * @param enabled	True to maintain and use the binary snapshot.
+ */
+void AppConfigurationBase::SetBinarySnapshotEnabled(bool enabled)
+{
+	m_binarySnapshotEnabled.store(enabled);
+}
+
+bool AppConfigurationBase::IsBinarySnapshotEnabled() const
+{
+	return m_binarySnapshotEnabled.load();
+}
+
+bool AppConfigurationBase::IsCompressedStorageEnabled() const
+{
+	return m_compressedStorage;
+}
+
+/**
+ * Enables storing each top-level section tag in a separate shard file, in a directory next to
+ * the config file, which then only contains the root element and its attributes. Only the shards
+ * whose sections changed are rewritten by a flush and the shards are loaded in parallel.
+ * The logical configuration and its API are not affected. Shards found on disk are loaded
+ * regardless of this setting, switching modes migrates the files with the next flush.
+ * Sharded storage always writes full shards, the persistence mode and binary snapshot are not used.
+ * Must be called before InitializeBase.
+ * @param enabled	True to use sharded storage.
+ */
+void AppConfigurationBase::SetShardedStorageEnabled(bool enabled)
+{
+	jassert(!m_fileFlushThread); // changing the storage layout after initialization is not supported
+
+	m_shardedStorageEnabled = enabled;
+}
+
+bool AppConfigurationBase::IsShardedStorageEnabled() const
+{
+	return m_shardedStorageEnabled;
+}
+
+/**
+ * Enables lazy parsing of the configuration's top-level sections. On startup, only the byte ranges
+ * of the root element's children are indexed. Each section is parsed on first access via
+ * getConfigState or setConfigState, untouched sections are written back verbatim on flush.
+ * Derived classes accessing m_xml directly must call ensureConfigSectionParsed beforehand.
+ * Must be called before InitializeBase.
+ * @param enabled	True to parse sections lazily.
+ */
+void AppConfigurationBase::SetLazySectionParsingEnabled(bool enabled)
+{
+	jassert(!m_fileFlushThread); // changing the parsing mode after initialization is not supported
+
+	m_lazySectionParsingEnabled = enabled;
+}
+
+bool AppConfigurationBase::IsLazySectionParsingEnabled() const
+{
+	return m_lazySectionParsingEnabled;
+}
+
+/**
+ * Makes sure the configuration sections with the given tag name are parsed into m_xml.
+ * @param tagName	The tag name of the sections to parse. All remaining sections are parsed if empty.
+ * @return	True if the sections are available in m_xml.
+ */
+bool AppConfigurationBase::ensureConfigSectionParsed(juce::StringRef tagName)
+{
+	if (!m_xml)
+		return false;
+
+	if (m_unparsedSections.empty())
+		return true;
+
+	auto unparsedSectionCount = m_unparsedSections.size();
+	auto unchangedSinceFlush = m_lastBuiltSnapshot && !m_snapshotPublishRequired && !m_snapshotRootPublishRequired
+		&& m_lastBuiltSnapshot->getHash() == m_lastFlushedHash;
+	auto success = parseUnparsedSections(*m_xml, m_unparsedSections, tagName);
+	if (unparsedSectionCount != m_unparsedSections.size())
+	{
+		invalidateConfigStateIndex(tagName);
+
+		// the snapshot does not need to change, since the parsed sections are equal to their unparsed text,
+		// but the newly parsed elements must be known to it to be shared by subsequent publishing
+		for (auto childElement : m_xml->getChildIterator())
+			if (tagName.isEmpty() || childElement->hasTagName(tagName))
+				stageConfigSnapshotSection(childElement);
+
+		// parsed sections hash differently than their text, which must not cause a rewrite of unchanged content
+		if (unchangedSinceFlush)
+			m_lastFlushedHash = buildConfigSnapshot()->getHash();
+	}
+
+	return success;
+}
+
+/**
+ * Enables monitoring the config file for changes made by other processes or by hand.
+ * Changed files are parsed in the background, only the sections that actually differ
+ * from the current configuration are applied and the affected watchers notified.
+ * Writes of this process are recognized by their content and do not trigger a reload.
+ * On Linux, the config file's directory is watched with inotify, otherwise the file's
+ * modification time and size are polled.
+ * @param enabled			True to monitor the config file.
+ * @param pollIntervalMs	The interval to poll the config file in, if it cannot be watched.
+ */
+void AppConfigurationBase::SetExternalChangeMonitoringEnabled(bool enabled, int pollIntervalMs)
+{
+	TeardownFileMonitorThread();
+
+	m_externalChangeMonitoringEnabled = enabled;
+	m_fileMonitorPollIntervalMs = juce::jmax(10, pollIntervalMs);
+
+	// before initialization, monitoring is started by InitializeBase
+	if (m_externalChangeMonitoringEnabled && m_file)
+		SetupFileMonitorThread();
+}
+
+bool AppConfigurationBase::IsExternalChangeMonitoringEnabled() const
+{
+	return m_externalChangeMonitoringEnabled;
+}
+
+/**
+ * Designates top-level sections to be shared live between all instances of the application on
+ * this host that use the same config. The shared sections are kept in a memory region that all
+ * instances map. A flush publishes changes of the shared sections to the region under a single
+ * writer lock, the other instances poll the region's sequence number and apply changes without
+ * reloading the config. The config itself is still stored by each instance as before.
+ * Must be called before InitializeBase.
+ * @param sectionTagNames		The tag names of the sections to share, empty to not share any.
+ * @param pollIntervalMs		The interval to check for changes of other instances in.
+ * @param regionCapacityBytes	The maximum size of the shared sections' xml text.
+ */
+void AppConfigurationBase::SetSharedSections(const juce::StringArray& sectionTagNames, int pollIntervalMs, size_t regionCapacityBytes)
+{
+	jassert(!m_fileFlushThread); // changing the shared sections after initialization is not supported
+
+	m_sharedSectionTagNames = sectionTagNames;
+	m_sharedRegionPollIntervalMs = juce::jmax(1, pollIntervalMs);
+	m_sharedRegionCapacity = regionCapacityBytes;
+}
+
+const juce::StringArray& AppConfigurationBase::GetSharedSections() const
+{
+	return m_sharedSectionTagNames;
 }
 
 bool AppConfigurationBase::IsFlushAndUpdateDisabled() const
@@ -11,6 +11,11 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "AppConfigurationSharedRegion.h"
+#include "AppConfigurationStorage.h"
+#include <array>
+#include <functional>
+#include <future>
 #include <thread>
 
 namespace JUCEAppBasics
@@ -19,6 +24,8 @@ namespace JUCEAppBasics
 class AppConfigurationBase
 {
 public:
+	class ConfigPatch;
+
 	class XmlConfigurableElement
 	{
 	public:
@@ -57,12 +64,8 @@ public:
 		virtual std::unique_ptr<juce::XmlElement> createStateXml() = 0;
 		virtual bool setStateXml(juce::XmlElement* stateXml) = 0;
 
-		void triggerConfigurationUpdate(bool includeWatcherUpdate)
-		{
-			auto config = AppConfigurationBase::getInstance();
-			if (config != nullptr)
-				config->triggerConfigurationDump(includeWatcherUpdate);
-		};
+		void triggerConfigurationUpdate(bool includeWatcherUpdate);
+		void triggerConfigurationPatch(const ConfigPatch& patch, bool includeWatcherUpdate);
 
 		bool& IsXmlChangeLocked()
 		{
@@ -79,6 +82,96 @@ public:
         virtual ~Dumper(){};
         
 		virtual void performConfigurationDump() = 0;
+
+		void setDirtyTrackingEnabled(bool enabled)
+		{
+			m_dirtyTrackingEnabled = enabled;
+		};
+		bool isDirtyTrackingEnabled() const
+		{
+			return m_dirtyTrackingEnabled;
+		};
+
+		void setConfigurationDirty(bool dirty = true)
+		{
+			m_configurationDirty.store(dirty);
+		};
+		bool isConfigurationDumpRequired() const
+		{
+			return !m_dirtyTrackingEnabled || m_configurationDirty.load();
+		};
+
+	private:
+		bool				m_dirtyTrackingEnabled{ false };
+		std::atomic<bool>	m_configurationDirty{ true };
+	};
+
+	class ConfigChangeSet
+	{
+	public:
+		void addChangedPath(const juce::String& path);
+		void setFullChange();
+		void merge(const ConfigChangeSet& other);
+		void clear();
+
+		bool isEmpty() const;
+		bool isFullChange() const;
+		const juce::StringArray& getChangedPaths() const;
+
+		bool affectsPath(const juce::String& path) const;
+		bool affectsAnyPath(const juce::StringArray& paths) const;
+
+	private:
+		juce::StringArray	m_changedPaths;
+		bool				m_fullChange{ false };
+	};
+
+	/**
+	 * Describes individual mutations of a top-level section, to be applied in place to the
+	 * configuration, instead of replacing the whole section with a new state via setConfigState.
+	 * The section is identified by its tag name and, optionally, by the value of a key attribute.
+	 */
+	class ConfigPatch
+	{
+	public:
+		explicit ConfigPatch(const juce::String& sectionTagName, const juce::String& keyAttributeName = juce::String(), int keyAttributeValue = 0);
+
+		ConfigPatch& setAttribute(const juce::String& name, const juce::String& value);
+		ConfigPatch& setAttribute(const juce::String& name, int value);
+		ConfigPatch& setAttribute(const juce::String& name, double value);
+		ConfigPatch& removeAttribute(const juce::String& name);
+		ConfigPatch& setChildAttribute(const juce::String& childTagName, const juce::String& name, const juce::String& value);
+		ConfigPatch& replaceChild(std::unique_ptr<juce::XmlElement> childXml);
+		ConfigPatch& removeChild(const juce::String& childTagName);
+
+		const juce::String& getSectionTagName() const;
+		bool isEmpty() const;
+
+	private:
+		friend class AppConfigurationBase;
+
+		enum OperationType
+		{
+			OT_SetAttribute = 0,
+			OT_RemoveAttribute,
+			OT_SetChildAttribute,
+			OT_ReplaceChild,
+			OT_RemoveChild,
+		};
+
+		struct Operation
+		{
+			OperationType							type;
+			juce::String							childTagName;
+			juce::String							name;
+			juce::String							value;
+			std::shared_ptr<const juce::XmlElement>	childXml;
+		};
+
+		juce::String			m_sectionTagName;
+		juce::String			m_keyAttributeName;
+		int						m_keyAttributeValue{ 0 };
+		std::vector<Operation>	m_operations;
 	};
 
 	class Watcher
@@ -87,6 +180,11 @@ public:
 		virtual ~Watcher(){};
 
 		virtual void onConfigUpdated() = 0;
+		virtual void onConfigChanged(const ConfigChangeSet& changes)
+		{
+			juce::ignoreUnused(changes);
+			onConfigUpdated();
+		};
 	};
 
 	class Version
@@ -176,6 +274,276 @@ public:
 		int m_fixlevel{ 0 };
 	};
 
+	class ConfigSnapshot
+	{
+	public:
+		const juce::String& getRootTagName() const;
+		std::shared_ptr<const juce::XmlElement> getRootElement() const;
+
+		int getNumSections() const;
+		std::shared_ptr<const juce::XmlElement> getSection(juce::StringRef tagName) const;
+		std::vector<std::shared_ptr<const juce::XmlElement>> getSections(juce::StringRef tagName = juce::StringRef()) const;
+
+		std::unique_ptr<juce::XmlElement> createXml() const;
+
+		juce::uint64 getHash() const;
+
+	private:
+		friend class AppConfigurationBase;
+
+		struct SectionHashes
+		{
+			juce::uint64				hash{ 0 };				// hash of the whole section subtree
+			juce::uint64				attributesHash{ 0 };	// hash of the section's own attributes
+			std::vector<juce::uint64>	childHashes;			// subtree hashes of the section's direct children
+		};
+
+		/**
+		 * Section that was changed by patches only. It shares the immutable xml of a previous
+		 * snapshot and the patches, and is only cloned and patched when it is first read.
+		 */
+		class PatchedXml
+		{
+		public:
+			PatchedXml(std::shared_ptr<const juce::XmlElement> baseXml, std::vector<std::shared_ptr<const ConfigPatch>> patches);
+
+			std::shared_ptr<const juce::XmlElement> getXml() const;
+			std::shared_ptr<const juce::XmlElement> getXmlIfCreated() const;
+
+			const std::shared_ptr<const juce::XmlElement>& getBaseXml() const;
+			const std::vector<std::shared_ptr<const ConfigPatch>>& getPatches() const;
+
+		private:
+			std::shared_ptr<const juce::XmlElement>			m_baseXml;
+			std::vector<std::shared_ptr<const ConfigPatch>>	m_patches;
+			mutable std::mutex								m_xmlMutex;
+			mutable std::shared_ptr<const juce::XmlElement>	m_xml;	// guarded by m_xmlMutex
+		};
+
+		struct Section
+		{
+			const juce::XmlElement*					liveElement{ nullptr };	// only to be used by the publishing thread
+			std::shared_ptr<const juce::XmlElement>	xml;
+			std::shared_ptr<const PatchedXml>		patchedXml;				// set instead of xml for sections only changed by patches
+			juce::String							tagName;
+			juce::String							unparsedText;
+			std::shared_ptr<const SectionHashes>	hashes;
+
+			bool isParsed() const;
+			const juce::XmlElement* getParsedXml() const;
+			std::shared_ptr<const juce::XmlElement> getXml() const;
+		};
+
+		std::shared_ptr<const juce::XmlElement>	m_root;
+		std::vector<Section>					m_sections;
+		juce::uint64							m_rootAttributesHash{ 0 };
+		juce::uint64							m_hash{ 0 };
+	};
+
+	class Metrics
+	{
+	public:
+		class Histogram
+		{
+		public:
+			void add(juce::int64 value);
+
+			juce::int64 getCount() const;
+			juce::int64 getSum() const;
+			juce::int64 getMin() const;
+			juce::int64 getMax() const;
+			double getMean() const;
+			juce::int64 getPercentile(double percentile) const;
+
+			juce::String toString() const;
+
+		private:
+			static constexpr int s_numBuckets = 40; // bucket i counts the values below 2^i
+
+			juce::int64								m_count{ 0 };
+			juce::int64								m_sum{ 0 };
+			juce::int64								m_min{ 0 };
+			juce::int64								m_max{ 0 };
+			std::array<juce::int64, s_numBuckets>	m_buckets{};
+		};
+
+		juce::int64	flushRequests{ 0 };			// flushes handed over to the flush thread
+		juce::int64	skippedFlushes{ 0 };		// flushes skipped since the content was unchanged
+		juce::int64	fullWrites{ 0 };			// config files written to disk
+		juce::int64	deltaJournalAppends{ 0 };	// batches of deltas appended to the journal
+		juce::int64	failedWrites{ 0 };
+		juce::int64	bytesWritten{ 0 };
+		juce::int64	binarySnapshotLoads{ 0 };	// loads that were served from the binary snapshot instead of parsing xml
+		juce::int64	replayedDeltas{ 0 };		// delta journal records replayed on load
+		juce::int64	unstagedChanges{ 0 };		// flushes that found changes made to m_xml without staging them
+
+		Histogram	loadTimeUs;					// reading and parsing the stored config, without replaying journal or shards
+		Histogram	bytesPerWrite;
+		Histogram	diskWriteTimeUs;
+		Histogram	flushQueueLatencyUs;		// from the oldest pending flush request until the flush thread picks it up
+		Histogram	deepCopyTimeUs;
+		Histogram	dumperTimeUs;
+		Histogram	watcherTimeUs;
+
+		juce::String toString() const;
+	};
+
+	class ScopedConfigTransaction
+	{
+	public:
+		explicit ScopedConfigTransaction(AppConfigurationBase& config);
+		~ScopedConfigTransaction();
+
+		bool commit();
+		void rollback();
+
+	private:
+		AppConfigurationBase&	m_config;
+		int						m_depth{ 0 };
+		bool					m_finished{ false };
+
+		JUCE_DECLARE_NON_COPYABLE(ScopedConfigTransaction)
+	};
+
+	/**
+	 * Compile-time declaration of a typed configuration value, an attribute of a top-level section.
+	 */
+	template <typename T>
+	struct ConfigKey
+	{
+		constexpr ConfigKey(const char* section, const char* attribute, T defaultVal)
+			: sectionTagName(section), attributeName(attribute), defaultValue(defaultVal)
+		{
+		};
+
+		const char*	sectionTagName;
+		const char*	attributeName;
+		T			defaultValue;
+	};
+
+	class TypedValueBase
+	{
+	public:
+		explicit TypedValueBase(AppConfigurationBase& config);
+		virtual ~TypedValueBase();
+
+		virtual const char* getSectionTagName() const = 0;
+		virtual void writeBack(juce::XmlElement& sectionXml) = 0;
+
+		bool isWriteBackPending() const
+		{
+			return m_writeBackPending.load(std::memory_order_acquire);
+		};
+
+	protected:
+		std::unique_lock<std::mutex> lockWriteBacks();
+		void setWriteBackPending();
+		void handOverWriteBack();
+
+		static void readAttribute(const juce::XmlElement& xml, const char* name, int& value);
+		static void readAttribute(const juce::XmlElement& xml, const char* name, juce::int64& value);
+		static void readAttribute(const juce::XmlElement& xml, const char* name, bool& value);
+		static void readAttribute(const juce::XmlElement& xml, const char* name, float& value);
+		static void readAttribute(const juce::XmlElement& xml, const char* name, double& value);
+		static void readAttribute(const juce::XmlElement& xml, const char* name, juce::String& value);
+
+		static void writeAttribute(juce::XmlElement& xml, const char* name, int value);
+		static void writeAttribute(juce::XmlElement& xml, const char* name, juce::int64 value);
+		static void writeAttribute(juce::XmlElement& xml, const char* name, bool value);
+		static void writeAttribute(juce::XmlElement& xml, const char* name, float value);
+		static void writeAttribute(juce::XmlElement& xml, const char* name, double value);
+		static void writeAttribute(juce::XmlElement& xml, const char* name, const juce::String& value);
+
+		AppConfigurationBase*	m_config;	// reset when the config is destroyed before this value
+
+	private:
+		friend class AppConfigurationBase;
+
+		std::atomic<bool>	m_writeBackPending{ false };
+	};
+
+	/**
+	 * Cached, typed access to a configuration value declared by a ConfigKey. The parsed value is kept
+	 * until a changed configuration snapshot is published, and only parsed again if the value's section
+	 * changed. A value that is set is visible immediately through this instance, but it is only written
+	 * to the configuration with the next flush. Until then, getConfigState, the snapshots, other instances
+	 * and the watchers still see the previous value. Every consumer is expected to use its own instance,
+	 * which may live on another thread than the message thread the configuration is flushed on.
+	 * An instance that outlives its configuration keeps returning its last value.
+	 */
+	template <typename T>
+	class TypedValue : public TypedValueBase
+	{
+	public:
+		TypedValue(AppConfigurationBase& config, const ConfigKey<T>& key)
+			: TypedValueBase(config), m_key(key), m_value(key.defaultValue)
+		{
+		};
+		~TypedValue() override
+		{
+			// handed over while this is still complete, since the base class cannot call writeBack any more
+			handOverWriteBack();
+		};
+
+		const T& get()
+		{
+			if (m_config == nullptr)
+				return m_value;
+
+			auto generation = m_config->getSnapshotGeneration();
+			if (generation != m_generation && !isWriteBackPending())
+				refresh(generation);
+
+			return m_value;
+		};
+		void set(const T& value)
+		{
+			if (value == get())
+				return;
+
+			// the value is read by writeBack on the message thread
+			auto writeBackLock = lockWriteBacks();
+			m_value = value;
+			setWriteBackPending();
+		};
+
+		const char* getSectionTagName() const override
+		{
+			return m_key.sectionTagName;
+		};
+		void writeBack(juce::XmlElement& sectionXml) override
+		{
+			writeAttribute(sectionXml, m_key.attributeName, m_value);
+		};
+
+	private:
+		void refresh(juce::uint64 generation)
+		{
+			m_generation = generation;
+
+			// published sections are immutable, an unchanged section pointer means an unchanged value
+			auto sectionXml = m_config->getConfigStateSnapshot(m_key.sectionTagName);
+			if (sectionXml == m_sectionXml && sectionXml)
+				return;
+			m_sectionXml = sectionXml;
+
+			m_value = m_key.defaultValue;
+			if (sectionXml && sectionXml->hasAttribute(m_key.attributeName))
+				readAttribute(*sectionXml, m_key.attributeName, m_value);
+		};
+
+		ConfigKey<T>							m_key;
+		T										m_value;
+		juce::uint64							m_generation{ ~juce::uint64(0) };
+		std::shared_ptr<const juce::XmlElement>	m_sectionXml;
+	};
+
+	enum PersistenceMode
+	{
+		PM_FullSnapshot = 0,
+		PM_DeltaJournal,
+	};
+
 public:
 	AppConfigurationBase();
 	virtual ~AppConfigurationBase();
@@ -184,26 +552,87 @@ public:
 	static AppConfigurationBase*	m_singleton;
 	static juce::String getDefaultConfigFilePath() noexcept;
 
-	void InitializeBase(const juce::File& file, const Version& configVersion = Version());
+	void InitializeBase(const juce::File& file, const Version& configVersion = Version(), bool compressed = false);
+	void InitializeBase(std::unique_ptr<AppConfigurationStorage> storage, const juce::String& configName, const Version& configVersion = Version(), bool compressed = false);
+	AppConfigurationStorage* getStorage() const;
+	const juce::String& getConfigName() const;
+	bool IsCompressedStorageEnabled() const;
 
 	bool UsesConfigVersion() { return m_configVersion.IsValid(); };
 
+	void SetPersistenceMode(PersistenceMode mode, juce::int64 deltaJournalCompactionThresholdBytes = 1024 * 1024);
+	PersistenceMode GetPersistenceMode() const;
+
+	void SetBinarySnapshotEnabled(bool enabled);
+	bool IsBinarySnapshotEnabled() const;
+
+	void SetShardedStorageEnabled(bool enabled);
+	bool IsShardedStorageEnabled() const;
+
+	void SetLazySectionParsingEnabled(bool enabled);
+	bool IsLazySectionParsingEnabled() const;
+	bool ensureConfigSectionParsed(juce::StringRef tagName = juce::StringRef());
+
+	void SetExternalChangeMonitoringEnabled(bool enabled, int pollIntervalMs = 1000);
+	bool IsExternalChangeMonitoringEnabled() const;
+
+	void SetSharedSections(const juce::StringArray& sectionTagNames, int pollIntervalMs = 20, size_t regionCapacityBytes = 1024 * 1024);
+	const juce::StringArray& GetSharedSections() const;
+
 	virtual bool isValid();
 	static bool isValid(const std::unique_ptr<juce::XmlElement>& xmlConfiguration);
 
+	virtual juce::String getRootTagName() const;
+
 	void addDumper(AppConfigurationBase::Dumper* d);
 	void triggerConfigurationDump(bool includeWatcherUpdate = true);
+	void triggerConfigurationFlush(bool includeWatcherUpdate = true);
+	bool flushPendingConfigurationDump();
 	void clearDumpers();
 
+	void SetFlushCoalescingWindow(int minIntervalMs, int maxLatencyMs);
+	bool IsFlushCoalescingEnabled() const;
+
 	void addWatcher(AppConfigurationBase::Watcher* w, bool initialUpdate = false);
+	void addWatcher(AppConfigurationBase::Watcher* w, const juce::StringArray& sectionPaths, bool initialUpdate = false);
 	void triggerWatcherUpdate();
 	void clearWatchers();
 
+	void SetWatcherUpdateAsynchronous(bool asynchronous);
+	bool IsWatcherUpdateAsynchronous() const;
+
 	std::unique_ptr<juce::XmlElement> getConfigState(juce::StringRef tagName = juce::StringRef());
 	bool setConfigState(std::unique_ptr<juce::XmlElement> stateXml, juce::StringRef attributeName = juce::StringRef());
 	bool resetConfigState(std::unique_ptr<juce::XmlElement> fullStateXml);
+	bool applyConfigPatch(const ConfigPatch& patch);
+
+	std::shared_ptr<const ConfigSnapshot> getConfigSnapshot() const;
+	std::shared_ptr<const juce::XmlElement> getConfigStateSnapshot(juce::StringRef tagName) const;
+	void publishConfigSnapshot(bool rootChanged = false);
+	juce::uint64 getSnapshotGeneration() const;
+
+	void writeBackTypedValues();
 
 	bool flushToDisk();
+	std::shared_future<bool> flushToDiskAsync();
+
+	Metrics getMetrics() const;
+	void resetMetrics();
+	bool dumpMetrics(const juce::File& file = juce::File()) const;
+
+	void beginTransaction();
+	bool commitTransaction();
+	void rollbackTransaction();
+	bool isInTransaction() const;
+	int getTransactionDepth() const;
+
+	void SetUndoHistoryLimit(int maxSteps);
+	int GetUndoHistoryLimit() const;
+	bool canUndo() const;
+	bool canRedo() const;
+	bool undo();
+	bool redo();
+	void clearUndoHistory();
 
 	bool IsFlushAndUpdateDisabled() const;
 	const std::pair<bool, bool>& GetFlushAndUpdateDisabled() const;
@@ -213,26 +642,206 @@ public:
 protected:
 	virtual bool HandleConfigVersionConflict(const Version& configVersionFound);
 
+	void invalidateConfigStateIndex(juce::StringRef tagName = juce::StringRef());
+	void addPendingConfigChanges(const ConfigChangeSet& changes);
+
+private:
+	/**
+	 * Change of a single section, to be appended to the delta journal. Either the new state of the section,
+	 * merged like in setConfigState, or the mutations of a patch, applied like in applyConfigPatch.
+	 */
+	struct DeltaRecord
+	{
+		juce::String							keyAttributeName;
+		std::shared_ptr<const juce::XmlElement>	stateXml;
+		std::shared_ptr<const ConfigPatch>		patch;
+	};
+
 protected:
 	std::unique_ptr<juce::XmlElement>	m_xml{ nullptr };
-	std::unique_ptr<juce::XmlElement>	m_xmlFileFlushCopy{ nullptr };
+	std::shared_ptr<const ConfigSnapshot>	m_snapshotFlushCopy;
+	std::vector<DeltaRecord>			m_deltaFlushQueue;
 	std::mutex							m_xmlCopyAccessMutex;
 
-	std::unique_ptr<juce::File>			m_file{ nullptr };
+	std::unique_ptr<AppConfigurationStorage>	m_storage;
+	juce::String						m_configName;
+	std::unique_ptr<juce::File>			m_file{ nullptr };	// only set if the storage backend exposes the config as file
 	std::unique_ptr<std::thread>	m_fileFlushThread;
 	std::atomic<bool>				m_fileFlushThreadActive;
 	std::condition_variable			m_fileFlushCV;
 	std::mutex						m_fileFlushCVMutex;
+	juce::uint64					m_flushRequestedGeneration{ 0 };	// guarded by m_fileFlushCVMutex
+	juce::uint64					m_flushWrittenGeneration{ 0 };		// guarded by m_fileFlushCVMutex
+	std::vector<std::pair<juce::uint64, std::promise<bool>>>	m_flushCompletions;	// guarded by m_fileFlushCVMutex
+	double							m_oldestPendingFlushRequestTimeMs{ 0.0 };	// guarded by m_fileFlushCVMutex
+
+private:
+	struct UnparsedSection
+	{
+		juce::String	tagName;
+		juce::String	text;
+		juce::uint64	textHash{ 0 };	// computed when first needed for a snapshot
+	};
+
+	struct TransactionSavepoint
+	{
+		std::shared_ptr<const ConfigSnapshot>	snapshot;
+		ConfigChangeSet							pendingConfigChanges;
+		size_t									pendingDeltaCount{ 0 };
+		bool									fullWriteRequired{ false };
+
+		bool	dumpDeferred{ false };
+		bool	flushDeferred{ false };
+		bool	watcherUpdateDeferred{ false };
+	};
+
+	struct StagedSection
+	{
+		std::shared_ptr<const juce::XmlElement>			xml;		// immutable copy to use, the live element is cloned if not set
+		std::vector<std::shared_ptr<const ConfigPatch>>	patches;	// set instead, if the section was only patched since the last build
+		bool											childStructureChanged{ false };
+		juce::StringArray								changedChildTagNames;
+	};
+
+	struct ConfigPatchEffect
+	{
+		ConfigChangeSet		changes;
+		bool				childStructureChanged{ false };	// children were added or removed
+		juce::StringArray	changedChildTagNames;			// children that were changed in place
+	};
+
+	class WatcherUpdateDispatcher : public juce::AsyncUpdater
+	{
+	public:
+		explicit WatcherUpdateDispatcher(AppConfigurationBase& owner) : m_owner(owner) {};
+
+		void handleAsyncUpdate() override
+		{
+			m_owner.dispatchWatcherUpdate();
+		};
+
+	private:
+		AppConfigurationBase& m_owner;
+	};
+
+	class ExternalChangeApplier : public juce::AsyncUpdater
+	{
+	public:
+		explicit ExternalChangeApplier(AppConfigurationBase& owner) : m_owner(owner) {};
+
+		void handleAsyncUpdate() override
+		{
+			m_owner.applyExternalConfigChange();
+		};
+
+	private:
+		AppConfigurationBase& m_owner;
+	};
+
+	class SharedRegionMonitor : public juce::Timer
+	{
+	public:
+		explicit SharedRegionMonitor(AppConfigurationBase& owner) : m_owner(owner) {};
+
+		void timerCallback() override
+		{
+			m_owner.pollSharedRegion();
+		};
+
+	private:
+		AppConfigurationBase& m_owner;
+	};
+
+	class DumpScheduler : public juce::Timer, public juce::AsyncUpdater
+	{
+	public:
+		explicit DumpScheduler(AppConfigurationBase& owner) : m_owner(owner) {};
+
+		void timerCallback() override
+		{
+			m_owner.processPendingConfigurationDump();
+		};
+
+		void handleAsyncUpdate() override
+		{
+			m_owner.processPendingConfigurationDump();
+		};
+
+	private:
+		AppConfigurationBase& m_owner;
+	};
 
 private:
 	void SetupFileFlushThread();
 	void TeardownFileFlushThread();
+	void SetupFileMonitorThread();
+	void TeardownFileMonitorThread();
+	void SetupSharedRegion();
+
+	void performConfigurationDump(bool includeWatcherUpdate);
+	void dispatchWatcherUpdate();
+	void schedulePendingConfigurationDump(bool includeWatcherUpdate);
+	void processPendingConfigurationDump();
 
 private:
 	bool initializeFromDisk();
 	bool exists();
 	bool create();
-	bool flush(bool includeWatcherUpdate);
+	bool flush(bool includeWatcherUpdate, std::promise<bool>* completion = nullptr);
+	bool writePendingFlush();
+	bool writeToDisk(const juce::XmlElement& xml, const std::vector<UnparsedSection>& unparsedSections);
+	bool writeToDisk(const ConfigSnapshot& snapshot);
+	bool writeConfigFile(const std::function<void(juce::OutputStream&)>& writeConfig);
+	bool appendToDeltaJournal(const std::vector<DeltaRecord>& deltas);
+	bool replayDeltaJournal();
+	bool writeBinarySnapshot(const juce::XmlElement& rootXml, const std::vector<const juce::XmlElement*>& sectionXmls);
+	std::unique_ptr<juce::XmlElement> readBinarySnapshot();
+	juce::String getAuxiliaryName(const juce::String& suffix) const;
+	bool readConfigFile(juce::MemoryBlock& configData) const;
+	static void decompressConfigData(juce::MemoryBlock& configData);
+	bool isConfigFileCompressed() const;
+	static bool isGZipData(const void* data, size_t size);
+	juce::String getShardPrefix() const;
+	juce::String getShardName(const juce::String& tagName) const;
+	bool loadShards();
+	bool writeShard(const juce::String& shardName, const juce::String& rootTagName, const std::vector<std::shared_ptr<const juce::XmlElement>>& sections);
+	static std::unique_ptr<juce::XmlElement> readShard(const AppConfigurationStorage& storage, const juce::String& shardName);
+	static std::map<juce::String, juce::uint64> getShardHashes(const ConfigSnapshot& snapshot);
+	void recordDiskWrite(bool success, bool fullWrite, juce::int64 bytes, double startTimeMs);
+	void recordOwnWrite(juce::uint64 fileHash);
+	void checkExternalConfigChange();
+	void applyExternalConfigChange();
+	void recordUndoStep(const std::shared_ptr<const ConfigSnapshot>& previousSnapshot, const std::shared_ptr<const ConfigSnapshot>& snapshot);
+	bool restoreConfigSnapshot(const std::shared_ptr<const ConfigSnapshot>& snapshot);
+	std::shared_ptr<const ConfigSnapshot> restoreConfigSnapshotSections(const ConfigSnapshot& snapshot);
+	bool publishSharedSections();
+	void pollSharedRegion();
+	bool applySharedSections(const juce::XmlElement& sharedXml);
+	juce::uint64 getSharedSectionsHash(const ConfigSnapshot& snapshot) const;
+
+	static void writeConfigXml(juce::OutputStream& stream, const juce::XmlElement& xml, const std::vector<UnparsedSection>& unparsedSections);
+	static void writeConfigSnapshot(juce::OutputStream& stream, const ConfigSnapshot& snapshot);
+	static bool parseUnparsedSections(juce::XmlElement& targetXml, std::vector<UnparsedSection>& unparsedSections, juce::StringRef tagName);
+	juce::XmlElement* mergeConfigStateIndexed(const juce::XmlElement& stateXml, juce::StringRef attributeName, ConfigChangeSet* changes = nullptr);
+	std::shared_ptr<const ConfigSnapshot> buildConfigSnapshot();
+	void stageConfigSnapshotSection(const juce::XmlElement* liveElement, std::shared_ptr<const juce::XmlElement> sectionXml = nullptr);
+	void stageUnstagedConfigChanges();
+	void stagePatchedConfigSnapshotSection(const juce::XmlElement* liveElement, std::shared_ptr<const ConfigPatch> patch, const ConfigPatchEffect& effect);
+	juce::XmlElement* applyConfigPatchInPlace(const ConfigPatch& patch, ConfigPatchEffect& effect);
+	static std::shared_ptr<const ConfigSnapshot::PatchedXml> createPatchedSectionXml(const ConfigSnapshot::Section& previousSection, const std::vector<std::shared_ptr<const ConfigPatch>>& patches);
+	std::unordered_map<int, juce::XmlElement*>& getConfigStateIndex(const juce::String& tagName, const juce::String& attributeName);
+
+	static juce::XmlElement* mergeConfigState(juce::XmlElement& targetXml, const juce::XmlElement& stateXml, juce::StringRef attributeName, ConfigChangeSet* changes = nullptr);
+	static void collectChangedPaths(const juce::XmlElement* previousXml, const juce::XmlElement& xml, ConfigChangeSet& changes,
+		const ConfigSnapshot::SectionHashes* previousHashes = nullptr, const ConfigSnapshot::SectionHashes* hashes = nullptr);
+	static void collectSnapshotChanges(const ConfigSnapshot& previousSnapshot, const ConfigSnapshot& snapshot, ConfigChangeSet& changes);
+	static juce::uint64 hashXml(const juce::XmlElement& xml, juce::uint64* attributesHash = nullptr, std::vector<juce::uint64>* childHashes = nullptr);
+	static std::shared_ptr<const ConfigSnapshot::SectionHashes> hashPatchedSection(const juce::XmlElement& sectionXml, const ConfigSnapshot::SectionHashes& previousHashes, const StagedSection& stagedSection);
+
+	static void applyConfigPatchOperations(juce::XmlElement& sectionXml, const ConfigPatch& patch, ConfigPatchEffect& effect);
+	static juce::XmlElement* findConfigPatchTarget(juce::XmlElement& rootXml, const ConfigPatch& patch);
+	static std::unique_ptr<juce::XmlElement> createConfigPatchXml(const ConfigPatch& patch);
+	static std::unique_ptr<ConfigPatch> createConfigPatchFromXml(const juce::XmlElement& patchXml);
 
 #ifdef DEBUG
 	void debugPrintXmlTree();
@@ -240,9 +849,88 @@ private:
 
 	std::vector<Dumper*>		m_dumpers;
 	std::vector<Watcher*>		m_watchers;
+	std::map<Watcher*, juce::StringArray>	m_watcherSubscriptions;
+	ConfigChangeSet							m_pendingConfigChanges;
+	std::unique_ptr<WatcherUpdateDispatcher>	m_watcherUpdateDispatcher;
 
 	std::pair<bool, bool>		m_flushAndUpdateDisabled{ false, false };
 
+	std::unique_ptr<DumpScheduler>	m_dumpScheduler;
+	int								m_flushCoalescingMinIntervalMs{ 0 };
+	int								m_flushCoalescingMaxLatencyMs{ 0 };
+	bool							m_dumpPending{ false };
+	bool							m_dumpPendingIncludesWatcherUpdate{ false };
+	bool							m_dumpPendingIncludesDumpers{ false };
+	juce::uint32					m_firstPendingDumpRequestTime{ 0 };
+	juce::uint32					m_lastPendingDumpRequestTime{ 0 };
+
+	PersistenceMode					m_persistenceMode{ PM_FullSnapshot };
+	juce::int64						m_deltaJournalCompactionThreshold{ 1024 * 1024 };
+	bool							m_fullWriteRequired{ true };
+	std::vector<DeltaRecord>		m_pendingDeltas;
+	std::unique_ptr<juce::XmlElement>	m_deltaJournalBaseXml;			// only accessed on the flush thread
+	std::vector<UnparsedSection>		m_deltaJournalBaseUnparsedSections;	// only accessed on the flush thread
+	std::atomic<bool>				m_binarySnapshotEnabled{ false };
+	bool							m_compressedStorage{ false };
+
+	bool							m_shardedStorageEnabled{ false };
+	std::map<juce::String, std::vector<std::shared_ptr<const juce::XmlElement>>>	m_shardFlushQueue;	// guarded by m_xmlCopyAccessMutex, empty shards are removed
+	std::unique_ptr<juce::XmlElement>	m_shardRootFlushCopy;		// guarded by m_xmlCopyAccessMutex
+	juce::String						m_shardRootTagName;			// guarded by m_xmlCopyAccessMutex
+	std::map<juce::String, juce::uint64>	m_lastFlushedShardHashes;
+	juce::uint64						m_lastFlushedShardRootHash{ 0 };
+
+	bool							m_lazySectionParsingEnabled{ false };
+	std::vector<UnparsedSection>	m_unparsedSections;
+
+	std::map<std::pair<juce::String, juce::String>, std::unordered_map<int, juce::XmlElement*>>	m_configStateIndex;
+
+	std::shared_ptr<const ConfigSnapshot>	m_publishedSnapshot;
+	std::atomic<juce::uint64>				m_snapshotGeneration{ 0 };
+	std::mutex								m_typedValuesMutex;					// guards the typed value registry and write backs
+	std::vector<TypedValueBase*>			m_typedValues;
+	std::vector<TypedValueBase*>			m_pendingTypedValueWriteBacks;
+	std::vector<std::unique_ptr<juce::XmlElement>>	m_handedOverTypedValueWriteBacks;	// of values destroyed before their write back
+	std::shared_ptr<const ConfigSnapshot>	m_lastBuiltSnapshot;
+	std::map<const juce::XmlElement*, StagedSection>	m_stagedSnapshotSections;
+	bool									m_snapshotPublishRequired{ true };
+	bool									m_snapshotRootPublishRequired{ true };
+	juce::uint64							m_lastFlushedHash{ 0 };
+	std::atomic<bool>						m_lastFlushWriteFailed{ false };
+	bool									m_loadedStateMatchesDisk{ false };
+
+	std::vector<TransactionSavepoint>	m_transactionSavepoints;
+
+	int										m_undoHistoryLimit{ 0 };
+	std::vector<std::shared_ptr<const ConfigSnapshot>>	m_undoHistory;
+	std::vector<std::shared_ptr<const ConfigSnapshot>>	m_redoHistory;
+	bool									m_restoringConfigSnapshot{ false };
+
+	bool								m_externalChangeMonitoringEnabled{ false };
+	int									m_fileMonitorPollIntervalMs{ 1000 };
+	std::unique_ptr<std::thread>		m_fileMonitorThread;
+	std::atomic<bool>					m_fileMonitorThreadActive{ false };
+	std::condition_variable				m_fileMonitorCV;
+	std::mutex							m_fileMonitorCVMutex;
+	juce::uint64						m_lastObservedFileHash{ 0 };	// only used by the monitor thread
+	std::vector<juce::uint64>			m_recentOwnWriteHashes;			// guarded by m_ownWriteHashesMutex
+	std::mutex							m_ownWriteHashesMutex;
+	std::unique_ptr<juce::XmlElement>	m_externalConfigXml;			// guarded by m_externalChangeMutex
+	std::vector<std::shared_ptr<const ConfigSnapshot::SectionHashes>>	m_externalConfigSectionHashes;	// guarded by m_externalChangeMutex
+	std::mutex							m_externalChangeMutex;
+	std::unique_ptr<ExternalChangeApplier>	m_externalChangeApplier;
+
+	juce::StringArray					m_sharedSectionTagNames;
+	int									m_sharedRegionPollIntervalMs{ 20 };
+	size_t								m_sharedRegionCapacity{ 1024 * 1024 };
+	std::unique_ptr<SharedConfigurationRegion>	m_sharedRegion;
+	std::unique_ptr<SharedRegionMonitor>	m_sharedRegionMonitor;
+	juce::uint64						m_sharedRegionSequence{ 0 };	// sequence of the last region write applied or made by this instance
+	juce::uint64						m_sharedSectionsHash{ 0 };		// hash of the shared sections last applied or published
+
+	Metrics								m_metrics;
+	mutable std::mutex					m_metricsMutex;
+
 	Version						m_configVersion;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AppConfigurationBase)
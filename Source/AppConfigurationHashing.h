@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    AppConfigurationHashing.h
+    Created: 17 Oct 2026 6:12:44pm
+    Author:  Christian Ahrens
+
+    Internal to the AppConfiguration sources, not to be included by applications.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace JUCEAppBasics
+{
+
+static constexpr juce::uint64 s_fnvOffsetBasis = 14695981039346656037ull;
+static constexpr juce::uint64 s_fnvPrime = 1099511628211ull;
+
+/**
+ * FNV-1a hash over the given bytes, continuing the given hash. Used for the journal record
+ * checksums of the storage backends as well as for the content hashes of AppConfigurationBase.
+ * @param hash	The hash to continue, s_fnvOffsetBasis to start a new one.
+ * @param data	The bytes to hash.
+ * @param size	The number of bytes.
+ * @return	The resulting hash.
+ */
+inline juce::uint64 hashBytes(juce::uint64 hash, const void* data, size_t size)
+{
+	auto bytes = static_cast<const juce::uint8*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= s_fnvPrime;
+	}
+	return hash;
+}
+
+}
@@ -0,0 +1,437 @@
+/* Copyright (c) 2026, Christian Ahrens
+ *
+ * This file is part of JUCEAppBasics <https://github.com/ChristianAhrens/JUCE-AppBasics>
+ *
+ * This module is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This module is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this tool; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AppConfigurationReplicator.h"
+
+namespace JUCEAppBasics
+{
+
+
+static constexpr juce::uint32 s_replicationMagic = 0x41435250; // "ACRP"
+static constexpr int s_connectTimeoutMs = 250;
+static constexpr juce::uint32 s_reconnectIntervalMs = 2000;
+
+
+//==============================================================================
+AppConfigurationReplicator::Connection::Connection(AppConfigurationReplicator& owner)
+    : juce::InterprocessConnection(true, s_replicationMagic), m_owner(owner)
+{
+}
+
+AppConfigurationReplicator::Connection::~Connection()
+{
+    disconnect();
+}
+
+void AppConfigurationReplicator::Connection::connectionMade()
+{
+    m_lost.store(false);
+
+    // a participant announces the versions it has, to receive a catch-up snapshot of what it missed
+    if (this == m_owner.m_masterConnection.get())
+        m_owner.sendHello();
+}
+
+void AppConfigurationReplicator::Connection::connectionLost()
+{
+    m_lost.store(true);
+}
+
+void AppConfigurationReplicator::Connection::messageReceived(const juce::MemoryBlock& message)
+{
+    m_owner.handleMessage(*this, message);
+}
+
+bool AppConfigurationReplicator::Connection::isLost() const
+{
+    return m_lost.load();
+}
+
+juce::InterprocessConnection* AppConfigurationReplicator::Server::createConnectionObject()
+{
+    // called on the server thread, the connection is owned by the replicator
+    auto connection = std::make_unique<Connection>(m_owner);
+    auto rawConnection = connection.get();
+
+    std::lock_guard<std::mutex> l(m_owner.m_participantConnectionsMutex);
+    m_owner.m_participantConnections.push_back(std::move(connection));
+
+    return rawConnection;
+}
+
+
+//==============================================================================
+AppConfigurationReplicator::AppConfigurationReplicator(AppConfigurationBase& config, const juce::StringArray& sectionTagNames, int batchIntervalMs)
+    : m_config(config), m_sectionTagNames(sectionTagNames), m_batchIntervalMs(juce::jmax(1, batchIntervalMs))
+{
+}
+
+AppConfigurationReplicator::~AppConfigurationReplicator()
+{
+    stop();
+}
+
+/**
+ * Starts replicating as session master, listening for participants on the given port.
+ * The current state of the replicated sections is the baseline version of this master.
+ * @param port  The TCP port to listen on.
+ * @return  True if listening on the port succeeded.
+ */
+bool AppConfigurationReplicator::startAsMaster(int port)
+{
+    if (m_role == R_Master && m_server && m_server->getBoundPort() == port)
+        return true;
+
+    stop();
+
+    m_server = std::make_unique<Server>(*this);
+    if (!m_server->beginWaitingForSocket(port))
+    {
+        DBG(juce::String(__FUNCTION__) + " unable to listen on port " + juce::String(port));
+        m_server.reset();
+        return false;
+    }
+
+    m_role = R_Master;
+    for (auto const& tagName : m_sectionTagNames)
+    {
+        m_versionVectors[tagName][m_nodeId]++;
+        m_lastReplicatedStates[tagName] = m_config.getConfigStateSnapshot(tagName);
+    }
+    m_lastSnapshotGeneration = m_config.getSnapshotGeneration();
+
+    startTimer(m_batchIntervalMs);
+
+    return true;
+}
+
+/**
+ * Starts replicating as session participant of the master listening on the given host and port.
+ * The connection is retried periodically until the master is reachable.
+ * @param masterHostName    The host name or IP address of the master.
+ * @param masterPort        The TCP port the master listens on.
+ */
+void AppConfigurationReplicator::startAsParticipant(const juce::String& masterHostName, int masterPort)
+{
+    if (m_role == R_Participant && m_masterHostName == masterHostName && m_masterPort == masterPort)
+        return;
+
+    stop();
+
+    m_role = R_Participant;
+    m_masterHostName = masterHostName;
+    m_masterPort = masterPort;
+    m_masterConnection = std::make_unique<Connection>(*this);
+
+    connectToMaster();
+
+    startTimer(m_batchIntervalMs);
+}
+
+void AppConfigurationReplicator::stop()
+{
+    stopTimer();
+
+    // the server is stopped first, to not create further connections while they are released
+    m_server.reset();
+    {
+        std::lock_guard<std::mutex> l(m_participantConnectionsMutex);
+        m_participantConnections.clear();
+    }
+    m_masterConnection.reset();
+    m_masterHostName.clear();
+    m_masterPort = 0;
+
+    m_lastReplicatedStates.clear();
+    m_role = R_None;
+}
+
+/**
+ * Derives the role from the topology discovered by ServiceTopologyManager. The master of the
+ * session the own service belongs to listens on its advertised port plus the given offset.
+ * @param topology                  The discovered session topology.
+ * @param ownServiceDescription     The description this instance advertises itself with.
+ * @param replicationPortOffset     The offset of the replication port to the advertised port.
+ */
+void AppConfigurationReplicator::updateFromServiceTopology(const SessionServiceTopology& topology, const juce::String& ownServiceDescription, int replicationPortOffset)
+{
+    for (auto const& session : topology)
+    {
+        auto const& master = session.first;
+        if (master.description.isEmpty() || master.sessionMasterDescription != master.description)
+            continue; // the 'No session' placeholder
+
+        if (master.description == ownServiceDescription)
+        {
+            startAsMaster(master.port + replicationPortOffset);
+            return;
+        }
+
+        for (auto const& participant : session.second)
+        {
+            if (participant.description == ownServiceDescription)
+            {
+                startAsParticipant(master.address.toString(), master.port + replicationPortOffset);
+                return;
+            }
+        }
+    }
+
+    stop();
+}
+
+AppConfigurationReplicator::Role AppConfigurationReplicator::getRole() const
+{
+    return m_role;
+}
+
+int AppConfigurationReplicator::getNumConnectedParticipants() const
+{
+    std::lock_guard<std::mutex> l(m_participantConnectionsMutex);
+    return int(std::count_if(m_participantConnections.begin(), m_participantConnections.end(),
+        [](const std::unique_ptr<Connection>& connection) { return connection->isConnected() && !connection->isLost(); }));
+}
+
+bool AppConfigurationReplicator::isConnectedToMaster() const
+{
+    return m_masterConnection && m_masterConnection->isConnected();
+}
+
+void AppConfigurationReplicator::timerCallback()
+{
+    if (m_role == R_Master)
+    {
+        pruneLostConnections();
+        collectAndSendChanges();
+    }
+    else if (m_role == R_Participant && !isConnectedToMaster()
+        && juce::Time::getMillisecondCounter() - m_lastConnectAttemptTime > s_reconnectIntervalMs)
+    {
+        connectToMaster();
+    }
+}
+
+/**
+ * Sends the replicated sections that changed since the last batch to all participants, as single
+ * batch message. Unchanged snapshot generations are detected without looking at the sections,
+ * unchanged sections by the identity of their immutable snapshot xml.
+ */
+void AppConfigurationReplicator::collectAndSendChanges()
+{
+    auto snapshotGeneration = m_config.getSnapshotGeneration();
+    if (snapshotGeneration == m_lastSnapshotGeneration)
+        return;
+    m_lastSnapshotGeneration = snapshotGeneration;
+
+    auto batchXml = juce::XmlElement("ReplicationBatch");
+    batchXml.setAttribute("node", m_nodeId);
+    for (auto const& tagName : m_sectionTagNames)
+    {
+        auto state = m_config.getConfigStateSnapshot(tagName);
+        auto& lastState = m_lastReplicatedStates[tagName];
+        if (state == lastState)
+            continue;
+
+        auto changed = state && (!lastState || !state->isEquivalentTo(lastState.get(), false));
+        lastState = state;
+        if (!changed)
+            continue;
+
+        m_versionVectors[tagName][m_nodeId]++;
+        batchXml.addChildElement(createSectionXml(tagName, true).release());
+    }
+
+    if (batchXml.getNumChildElements() == 0)
+        return;
+
+    // Sending blocks, so it is done without holding the lock the server thread needs to add connections.
+    // Connections are only released on this thread, the pointers stay valid while sending.
+    std::vector<Connection*> connections;
+    {
+        std::lock_guard<std::mutex> l(m_participantConnectionsMutex);
+        for (auto const& connection : m_participantConnections)
+            connections.push_back(connection.get());
+    }
+
+    for (auto connection : connections)
+        if (connection->isConnected() && !connection->isLost())
+            sendXml(*connection, batchXml);
+}
+
+void AppConfigurationReplicator::pruneLostConnections()
+{
+    std::lock_guard<std::mutex> l(m_participantConnectionsMutex);
+    m_participantConnections.erase(std::remove_if(m_participantConnections.begin(), m_participantConnections.end(),
+        [](const std::unique_ptr<Connection>& connection) { return connection->isLost(); }), m_participantConnections.end());
+}
+
+void AppConfigurationReplicator::connectToMaster()
+{
+    m_lastConnectAttemptTime = juce::Time::getMillisecondCounter();
+    if (!m_masterConnection->connectToSocket(m_masterHostName, m_masterPort, s_connectTimeoutMs))
+        DBG(juce::String(__FUNCTION__) + " unable to connect to " + m_masterHostName + ":" + juce::String(m_masterPort) + ", retrying");
+}
+
+void AppConfigurationReplicator::handleMessage(Connection& connection, const juce::MemoryBlock& message)
+{
+    auto messageXml = juce::parseXML(message.toString());
+    if (!messageXml)
+    {
+        DBG(juce::String(__FUNCTION__) + " unable to parse replication message");
+        return;
+    }
+
+    if (m_role == R_Master && messageXml->hasTagName("ReplicationHello"))
+        handleHello(connection, *messageXml);
+    else if (m_role == R_Participant && &connection == m_masterConnection.get() && messageXml->hasTagName("ReplicationBatch"))
+        handleBatch(*messageXml);
+}
+
+/**
+ * Answers a participant's hello with a catch-up snapshot of all sections whose version
+ * the participant has not seen yet.
+ * @param connection    The participant's connection.
+ * @param helloXml      The participant's version vectors.
+ */
+void AppConfigurationReplicator::handleHello(Connection& connection, const juce::XmlElement& helloXml)
+{
+    std::map<juce::String, VersionVector> participantVersionVectors;
+    for (auto sectionXml : helloXml.getChildWithTagNameIterator("Section"))
+        participantVersionVectors[sectionXml->getStringAttribute("tag")] = versionVectorFromString(sectionXml->getStringAttribute("versions"));
+
+    auto catchUpXml = juce::XmlElement("ReplicationBatch");
+    catchUpXml.setAttribute("node", m_nodeId);
+    for (auto const& tagName : m_sectionTagNames)
+        if (!dominates(participantVersionVectors[tagName], m_versionVectors[tagName]))
+            catchUpXml.addChildElement(createSectionXml(tagName, true).release());
+
+    DBG(juce::String(__FUNCTION__) + " catching up " + helloXml.getStringAttribute("node") + " with " + juce::String(catchUpXml.getNumChildElements()) + " sections");
+
+    if (catchUpXml.getNumChildElements() > 0)
+        sendXml(connection, catchUpXml);
+}
+
+/**
+ * Applies the sections of a batch received from the master, unless the local version
+ * already includes the received one, e.g. a section that was part of a catch-up snapshot
+ * and a regular batch. Flushing the applied sections and notifying the watchers is requested
+ * through the coalesced flush, so bursts of batches do not cause a write each.
+ * @param batchXml  The batch of sections.
+ */
+void AppConfigurationReplicator::handleBatch(const juce::XmlElement& batchXml)
+{
+    juce::StringArray appliedTagNames;
+    for (auto sectionXml : batchXml.getChildWithTagNameIterator("Section"))
+    {
+        auto tagName = sectionXml->getStringAttribute("tag");
+        auto stateXml = sectionXml->getFirstChildElement();
+        if (!m_sectionTagNames.contains(tagName) || stateXml == nullptr || !stateXml->hasTagName(tagName))
+            continue;
+
+        auto versionVector = versionVectorFromString(sectionXml->getStringAttribute("versions"));
+        auto& localVersionVector = m_versionVectors[tagName];
+        if (dominates(localVersionVector, versionVector))
+            continue;
+
+        // concurrent versions are resolved in favour of the master
+        mergeVersionVector(localVersionVector, versionVector);
+        if (m_config.setConfigState(std::make_unique<juce::XmlElement>(*stateXml)))
+            appliedTagNames.add(tagName);
+    }
+
+    if (appliedTagNames.isEmpty())
+        return;
+
+    m_config.triggerConfigurationFlush(true);
+
+    juce::NullCheckedInvocation::invoke(onSectionsReplicated, appliedTagNames);
+}
+
+void AppConfigurationReplicator::sendHello()
+{
+    auto helloXml = juce::XmlElement("ReplicationHello");
+    helloXml.setAttribute("node", m_nodeId);
+    for (auto const& tagName : m_sectionTagNames)
+        helloXml.addChildElement(createSectionXml(tagName, false).release());
+
+    sendXml(*m_masterConnection, helloXml);
+}
+
+std::unique_ptr<juce::XmlElement> AppConfigurationReplicator::createSectionXml(const juce::String& tagName, bool includeState) const
+{
+    auto sectionXml = std::make_unique<juce::XmlElement>("Section");
+    sectionXml->setAttribute("tag", tagName);
+
+    auto versionVector = m_versionVectors.find(tagName);
+    sectionXml->setAttribute("versions", versionVector != m_versionVectors.end() ? versionVectorToString(versionVector->second) : juce::String());
+
+    if (includeState)
+        if (auto stateXml = m_config.getConfigStateSnapshot(tagName))
+            sectionXml->addChildElement(new juce::XmlElement(*stateXml));
+
+    return sectionXml;
+}
+
+bool AppConfigurationReplicator::sendXml(Connection& connection, const juce::XmlElement& xml)
+{
+    auto text = xml.toString(juce::XmlElement::TextFormat().singleLine().withoutHeader());
+    return connection.sendMessage(juce::MemoryBlock(text.toRawUTF8(), text.getNumBytesAsUTF8()));
+}
+
+juce::String AppConfigurationReplicator::versionVectorToString(const VersionVector& versionVector)
+{
+    juce::StringArray entries;
+    for (auto const& entry : versionVector)
+        entries.add(entry.first + "=" + juce::String(entry.second));
+    return entries.joinIntoString(";");
+}
+
+AppConfigurationReplicator::VersionVector AppConfigurationReplicator::versionVectorFromString(const juce::String& versionVectorString)
+{
+    VersionVector versionVector;
+    for (auto const& entry : juce::StringArray::fromTokens(versionVectorString, ";", ""))
+        if (entry.containsChar('='))
+            versionVector[entry.upToFirstOccurrenceOf("=", false, false)] = juce::uint64(entry.fromFirstOccurrenceOf("=", false, false).getLargeIntValue());
+    return versionVector;
+}
+
+/**
+ * Checks if a version vector includes all versions of another one.
+ * @param versionVector The version vector to check.
+ * @param other         The version vector to compare to.
+ * @return  True if every counter of other is less than or equal to the one in versionVector.
+ */
+bool AppConfigurationReplicator::dominates(const VersionVector& versionVector, const VersionVector& other)
+{
+    for (auto const& entry : other)
+    {
+        auto counter = versionVector.find(entry.first);
+        if (counter == versionVector.end() || counter->second < entry.second)
+            return false;
+    }
+    return true;
+}
+
+void AppConfigurationReplicator::mergeVersionVector(VersionVector& target, const VersionVector& other)
+{
+    for (auto const& entry : other)
+        target[entry.first] = juce::jmax(target[entry.first], entry.second);
+}
+
+
+} // namespace JUCEAppBasics
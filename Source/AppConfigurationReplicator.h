@@ -0,0 +1,145 @@
+/* Copyright (c) 2026, Christian Ahrens
+ *
+ * This file is part of JUCEAppBasics <https://github.com/ChristianAhrens/JUCE-AppBasics>
+ *
+ * This module is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This module is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this tool; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <JuceHeader.h>
+
+#include "AppConfigurationBase.h"
+#include "ServiceTopologyManager.h"
+
+
+namespace JUCEAppBasics
+{
+
+
+/**
+ * AppConfigurationReplicator keeps a designated set of top-level config sections consistent
+ * between the master of a session and its participants, as discovered by ServiceTopologyManager.
+ *
+ * The master listens on a TCP port, participants connect to it. Changes of the replicated
+ * sections on the master are collected and streamed to all participants in batches. Every section
+ * carries a version vector with one counter per master that changed it. A participant joining late
+ * or reconnecting sends its version vectors and receives a catch-up snapshot of the sections it
+ * has not seen the latest version of. Participants apply changed sections via setConfigState,
+ * so the usual watchers are notified. Replication is one way, from the master to the participants.
+ *
+ * The role can be derived from the discovered topology (see updateFromServiceTopology) or set up
+ * explicitly, e.g. to test with multiple instances on loopback.
+ */
+class AppConfigurationReplicator : private juce::Timer
+{
+public:
+    enum Role
+    {
+        R_None = 0,
+        R_Master,
+        R_Participant,
+    };
+
+public:
+    AppConfigurationReplicator(AppConfigurationBase& config, const juce::StringArray& sectionTagNames, int batchIntervalMs = 50);
+    ~AppConfigurationReplicator() override;
+
+    bool startAsMaster(int port);
+    void startAsParticipant(const juce::String& masterHostName, int masterPort);
+    void stop();
+
+    void updateFromServiceTopology(const SessionServiceTopology& topology, const juce::String& ownServiceDescription, int replicationPortOffset = 1);
+
+    Role getRole() const;
+    int getNumConnectedParticipants() const;
+    bool isConnectedToMaster() const;
+
+    std::function<void(const juce::StringArray&)> onSectionsReplicated;    /**< Called on participants with the tag names of the sections that were applied. */
+
+private:
+    using VersionVector = std::map<juce::String, juce::uint64>;
+
+    class Connection : public juce::InterprocessConnection
+    {
+    public:
+        explicit Connection(AppConfigurationReplicator& owner);
+        ~Connection() override;
+
+        void connectionMade() override;
+        void connectionLost() override;
+        void messageReceived(const juce::MemoryBlock& message) override;
+
+        bool isLost() const;
+
+    private:
+        AppConfigurationReplicator& m_owner;
+        std::atomic<bool> m_lost{ false };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Connection)
+    };
+
+    class Server : public juce::InterprocessConnectionServer
+    {
+    public:
+        explicit Server(AppConfigurationReplicator& owner) : m_owner(owner) {};
+
+    protected:
+        juce::InterprocessConnection* createConnectionObject() override;
+
+    private:
+        AppConfigurationReplicator& m_owner;
+    };
+
+    void timerCallback() override;
+
+    void collectAndSendChanges();
+    void pruneLostConnections();
+    void connectToMaster();
+
+    void handleMessage(Connection& connection, const juce::MemoryBlock& message);
+    void handleHello(Connection& connection, const juce::XmlElement& helloXml);
+    void handleBatch(const juce::XmlElement& batchXml);
+    void sendHello();
+
+    std::unique_ptr<juce::XmlElement> createSectionXml(const juce::String& tagName, bool includeState) const;
+    static bool sendXml(Connection& connection, const juce::XmlElement& xml);
+
+    static juce::String versionVectorToString(const VersionVector& versionVector);
+    static VersionVector versionVectorFromString(const juce::String& versionVectorString);
+    static bool dominates(const VersionVector& versionVector, const VersionVector& other);
+    static void mergeVersionVector(VersionVector& target, const VersionVector& other);
+
+    AppConfigurationBase&   m_config;
+    juce::StringArray       m_sectionTagNames;
+    int                     m_batchIntervalMs{ 50 };
+    const juce::String      m_nodeId{ juce::Uuid().toString() };
+    Role                    m_role{ R_None };
+
+    std::map<juce::String, VersionVector>                           m_versionVectors;
+    std::map<juce::String, std::shared_ptr<const juce::XmlElement>> m_lastReplicatedStates;    // master only
+    juce::uint64                                                    m_lastSnapshotGeneration{ 0 };
+
+    std::unique_ptr<Server>                     m_server;
+    std::vector<std::unique_ptr<Connection>>    m_participantConnections;  // created on the server thread, guarded by m_participantConnectionsMutex
+    mutable std::mutex                          m_participantConnectionsMutex;
+
+    std::unique_ptr<Connection> m_masterConnection;
+    juce::String                m_masterHostName;
+    int                         m_masterPort{ 0 };
+    juce::uint32                m_lastConnectAttemptTime{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AppConfigurationReplicator)
+};
+
+} // namespace JUCEAppBasics
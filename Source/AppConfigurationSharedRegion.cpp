@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    AppConfigurationSharedRegion.cpp
+    Created: 17 Oct 2026 6:04:52pm
+    Author:  Christian Ahrens
+
+  ==============================================================================
+*/
+
+#include "AppConfigurationSharedRegion.h"
+
+#include <cstring>
+#include <thread>
+
+namespace JUCEAppBasics
+{
+
+static constexpr juce::uint32 s_sharedRegionMagic = 0x52534341; // "ACSR"
+static constexpr juce::uint32 s_sharedRegionFormatVersion = 1;
+static constexpr int s_maxReadAttempts = 1000;
+
+/**
+ * Opens the shared region with the given name, creating it if no other process did so before.
+ * @param name			The name identifying the region on this host.
+ * @param capacityBytes	The maximum payload size. A region that already exists with a larger capacity is used as it is.
+ */
+SharedConfigurationRegion::SharedConfigurationRegion(const juce::String& name, size_t capacityBytes)
+{
+	auto legalName = juce::File::createLegalFileName(name);
+	m_file = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile(legalName + ".shm");
+	m_writerLock = std::make_unique<juce::InterProcessLock>(legalName + "_writer");
+
+	// the region is set up under the writer lock, to not race with another process doing the same
+	if (!m_writerLock->enter(1000))
+	{
+		DBG(juce::String(__FUNCTION__) + " unable to lock shared region " + m_file.getFullPathName());
+		return;
+	}
+
+	auto regionSize = juce::int64(sizeof(Header) + capacityBytes);
+	auto fileSize = m_file.getSize();
+	if (fileSize < regionSize)
+	{
+		juce::FileOutputStream regionStream(m_file);
+		if (regionStream.openedOk() && regionStream.setPosition(fileSize))
+		{
+			regionStream.writeRepeatedByte(0, size_t(regionSize - fileSize));
+			regionStream.flush();
+		}
+	}
+
+	m_mappedFile = std::make_unique<juce::MemoryMappedFile>(m_file, juce::MemoryMappedFile::readWrite, false);
+	if (m_mappedFile->getData() == nullptr || juce::int64(m_mappedFile->getSize()) < regionSize)
+	{
+		DBG(juce::String(__FUNCTION__) + " unable to map shared region " + m_file.getFullPathName());
+		m_mappedFile.reset();
+	}
+	else
+	{
+		auto header = getHeader();
+		if (header->magic != s_sharedRegionMagic || header->formatVersion != s_sharedRegionFormatVersion)
+		{
+			header->sequence.store(0);
+			header->payloadSize.store(0);
+			header->writeTimeMs.store(0);
+			header->formatVersion = s_sharedRegionFormatVersion;
+			header->magic = s_sharedRegionMagic;
+		}
+		m_capacity = m_mappedFile->getSize() - sizeof(Header);
+	}
+
+	m_writerLock->exit();
+}
+
+SharedConfigurationRegion::~SharedConfigurationRegion()
+{
+}
+
+bool SharedConfigurationRegion::isValid() const
+{
+	return m_mappedFile != nullptr;
+}
+
+size_t SharedConfigurationRegion::getCapacity() const
+{
+	return m_capacity;
+}
+
+/**
+ * Provides the sequence number of the last write, zero if the region was never written.
+ * It is odd while a write is in progress.
+ * @return	The current sequence number.
+ */
+juce::uint64 SharedConfigurationRegion::getSequence() const
+{
+	return isValid() ? getHeader()->sequence.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * Provides the wall-clock time of the last write.
+ * @return	The time in milliseconds since the epoch, zero if the region was never written.
+ */
+juce::int64 SharedConfigurationRegion::getWriteTime() const
+{
+	return isValid() ? getHeader()->writeTimeMs.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * Copies the current payload without locking. Copies overlapping with a write are detected by
+ * the changed sequence number and retried.
+ * @param payload	The target for the payload.
+ * @param sequence	The target for the sequence number of the write the payload was copied from.
+ * @return	True if a consistent copy was made, false if the region is invalid or was written continuously.
+ */
+bool SharedConfigurationRegion::read(juce::MemoryBlock& payload, juce::uint64& sequence) const
+{
+	if (!isValid())
+		return false;
+
+	auto header = getHeader();
+	for (int attempt = 0; attempt < s_maxReadAttempts; ++attempt)
+	{
+		auto startSequence = header->sequence.load(std::memory_order_acquire);
+		if ((startSequence & 1) == 0)
+		{
+			auto payloadSize = header->payloadSize.load(std::memory_order_relaxed);
+			auto sizeIsValid = payloadSize <= m_capacity;
+			if (sizeIsValid)
+				payload.replaceAll(getPayload(), size_t(payloadSize));
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (header->sequence.load(std::memory_order_relaxed) == startSequence)
+			{
+				sequence = startSequence;
+				return sizeIsValid;
+			}
+		}
+
+		std::this_thread::yield();
+	}
+
+	return false;
+}
+
+/**
+ * Replaces the payload, holding the writer lock for the duration of the copy. A write that was
+ * interrupted by the death of its process is recognized by the odd sequence number and superseded.
+ * @param payload		The payload data.
+ * @param numBytes		The payload size, must not exceed the region's capacity.
+ * @param lockTimeoutMs	The time to wait for another process to finish writing.
+ * @param sequence		The target for the sequence number of this write.
+ * @return	True on success, false if the payload is too large or the writer lock could not be acquired.
+ */
+bool SharedConfigurationRegion::write(const void* payload, size_t numBytes, int lockTimeoutMs, juce::uint64& sequence)
+{
+	if (!isValid())
+		return false;
+
+	if (numBytes > m_capacity)
+	{
+		DBG(juce::String(__FUNCTION__) + " payload of " + juce::String(numBytes) + " bytes exceeds the shared region's capacity of " + juce::String(m_capacity) + " bytes");
+		return false;
+	}
+
+	if (!m_writerLock->enter(lockTimeoutMs))
+		return false;
+
+	auto header = getHeader();
+	auto previousSequence = header->sequence.load(std::memory_order_relaxed);
+	auto writeSequence = previousSequence + 1 + (previousSequence & 1);
+
+	header->sequence.store(writeSequence, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::memcpy(getPayload(), payload, numBytes);
+	header->payloadSize.store(juce::uint64(numBytes), std::memory_order_relaxed);
+	header->writeTimeMs.store(juce::Time::currentTimeMillis(), std::memory_order_relaxed);
+
+	header->sequence.store(writeSequence + 1, std::memory_order_release);
+
+	m_writerLock->exit();
+
+	sequence = writeSequence + 1;
+
+	return true;
+}
+
+SharedConfigurationRegion::Header* SharedConfigurationRegion::getHeader() const
+{
+	return static_cast<Header*>(m_mappedFile->getData());
+}
+
+juce::uint8* SharedConfigurationRegion::getPayload() const
+{
+	return static_cast<juce::uint8*>(m_mappedFile->getData()) + sizeof(Header);
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    AppConfigurationSharedRegion.h
+    Created: 17 Oct 2026 6:04:52pm
+    Author:  Christian Ahrens
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+namespace JUCEAppBasics
+{
+
+/**
+ * Memory region shared by all processes on the host that open it with the same name.
+ * It is backed by a memory mapped file in the temporary directory and holds a single payload.
+ * Writers are serialized by an InterProcessLock, readers do not lock at all. They copy the payload
+ * under a sequence lock: the sequence number is odd while a write is in progress and a copy is only
+ * valid if the sequence number did not change while copying. Polling the sequence number is
+ * therefore a cheap way to be notified of changes made by other processes.
+ */
+class SharedConfigurationRegion
+{
+public:
+	SharedConfigurationRegion(const juce::String& name, size_t capacityBytes);
+	~SharedConfigurationRegion();
+
+	bool isValid() const;
+	size_t getCapacity() const;
+
+	juce::uint64 getSequence() const;
+	juce::int64 getWriteTime() const;
+
+	bool read(juce::MemoryBlock& payload, juce::uint64& sequence) const;
+	bool write(const void* payload, size_t numBytes, int lockTimeoutMs, juce::uint64& sequence);
+
+private:
+	struct Header
+	{
+		juce::uint32				magic;
+		juce::uint32				formatVersion;
+		std::atomic<juce::uint64>	sequence;
+		std::atomic<juce::uint64>	payloadSize;
+		std::atomic<juce::int64>	writeTimeMs;
+	};
+	static_assert(std::atomic<juce::uint64>::is_always_lock_free && std::atomic<juce::int64>::is_always_lock_free,
+		"the sequence lock requires lock free atomics to work across processes");
+
+	Header* getHeader() const;
+	juce::uint8* getPayload() const;
+
+	juce::File									m_file;
+	std::unique_ptr<juce::InterProcessLock>		m_writerLock;
+	std::unique_ptr<juce::MemoryMappedFile>		m_mappedFile;
+	size_t										m_capacity{ 0 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedConfigurationRegion)
+};
+
+}
@@ -0,0 +1,532 @@
+/*
+  ==============================================================================
+
+    AppConfigurationStorage.cpp
+    Created: 17 Oct 2026 3:21:07pm
+    Author:  Christian Ahrens
+
+  ==============================================================================
+*/
+
+#include "AppConfigurationStorage.h"
+#include "AppConfigurationHashing.h"
+
+namespace JUCEAppBasics
+{
+
+static constexpr size_t s_fileBufferSize = 64 * 1024;
+
+//==============================================================================
+FileConfigurationStorage::FileConfigurationStorage(const juce::File& directory)
+	: m_directory(directory)
+{
+}
+
+FileConfigurationStorage::~FileConfigurationStorage()
+{
+}
+
+bool FileConfigurationStorage::exists(const juce::String& name) const
+{
+	return getFile(name).existsAsFile();
+}
+
+bool FileConfigurationStorage::read(const juce::String& name, juce::MemoryBlock& data, juce::int64 maxNumBytes) const
+{
+	auto file = getFile(name);
+	if (maxNumBytes < 0)
+		return file.loadFileAsData(data);
+
+	juce::FileInputStream fileStream(file);
+	if (!fileStream.openedOk())
+		return false;
+
+	data.reset();
+	fileStream.readIntoMemoryBlock(data, static_cast<ssize_t>(maxNumBytes));
+
+	return true;
+}
+
+/**
+ * Memory maps the file, so its content is read by the consumer in a single pass without an intermediate copy.
+ * @param name			The name of the file to read.
+ * @param readContent	Reads the mapped file content.
+ * @return	True on success, false if the file could not be mapped.
+ */
+bool FileConfigurationStorage::readMapped(const juce::String& name, const std::function<void(const void* data, size_t numBytes)>& readContent) const
+{
+	juce::MemoryMappedFile mappedFile(getFile(name), juce::MemoryMappedFile::readOnly);
+	if (mappedFile.getData() == nullptr)
+		return false;
+
+	readContent(mappedFile.getData(), mappedFile.getSize());
+	return true;
+}
+
+/**
+ * Writes a file in a crash-safe way.
+ * The content is written to a temporary sibling file and synced to disk first.
+ * A small journal file is then written to record that the temporary file is complete,
+ * before it is renamed to replace the actual file. If the process dies at any point,
+ * either the previous or the new file content is found by recoverInterruptedWrite.
+ * @param name			The name of the file to write.
+ * @param writeContent	Writes the file content to the given stream.
+ * @return	True on success, false if any of the steps failed.
+ */
+bool FileConfigurationStorage::writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent)
+{
+	auto file = getFile(name);
+	auto tempFile = getFile(name + ".tmp");
+	auto journalFile = getFile(name + ".journal");
+
+	if (!file.getParentDirectory().isDirectory() && file.getParentDirectory().createDirectory().failed())
+		return false;
+
+	{
+		juce::FileOutputStream tempStream(tempFile, s_fileBufferSize);
+		if (!tempStream.openedOk() || !tempStream.setPosition(0) || !tempStream.truncate().wasOk())
+			return false;
+
+		writeContent(tempStream);
+		tempStream.flush(); // flushing a FileOutputStream syncs the data to the device as well
+		if (tempStream.getStatus().failed())
+			return false;
+	}
+
+	{
+		juce::FileOutputStream journalStream(journalFile);
+		if (!journalStream.openedOk() || !journalStream.setPosition(0) || !journalStream.truncate().wasOk())
+			return false;
+
+		journalStream << juce::String(tempFile.getSize());
+		journalStream.flush();
+		if (journalStream.getStatus().failed())
+			return false;
+	}
+
+	if (!tempFile.moveFileTo(file))
+		return false;
+
+	return journalFile.deleteFile();
+}
+
+bool FileConfigurationStorage::append(const juce::String& name, const void* data, size_t numBytes)
+{
+	juce::FileOutputStream fileStream(getFile(name), s_fileBufferSize);
+	if (!fileStream.openedOk())
+		return false;
+
+	fileStream.write(data, numBytes);
+	fileStream.flush(); // flushing a FileOutputStream syncs the data to the device as well
+
+	return fileStream.getStatus().wasOk();
+}
+
+bool FileConfigurationStorage::remove(const juce::String& name)
+{
+	auto file = getFile(name);
+	if (!file.existsAsFile())
+		return true;
+
+	if (!file.deleteFile())
+		return false;
+
+	// directories that only held removed files, e.g. shards, are removed as well
+	auto directory = file.getParentDirectory();
+	if (directory != m_directory && directory.isDirectory() && directory.getNumberOfChildFiles(juce::File::findFilesAndDirectories) == 0)
+		directory.deleteFile();
+
+	return true;
+}
+
+juce::int64 FileConfigurationStorage::getSize(const juce::String& name) const
+{
+	return getFile(name).getSize();
+}
+
+juce::int64 FileConfigurationStorage::getModificationTime(const juce::String& name) const
+{
+	return getFile(name).getLastModificationTime().toMilliseconds();
+}
+
+/**
+ * Lists the files whose names start with the given prefix. If the prefix contains
+ * a directory part, only files in that directory are considered.
+ * @param prefix	The name prefix.
+ * @return	The names of the matching files, sorted.
+ */
+juce::StringArray FileConfigurationStorage::getNames(const juce::String& prefix) const
+{
+	auto directoryPart = prefix.containsChar('/') ? prefix.upToLastOccurrenceOf("/", true, false) : juce::String();
+	auto namePart = prefix.fromLastOccurrenceOf("/", false, false);
+	auto directory = directoryPart.isEmpty() ? m_directory : m_directory.getChildFile(directoryPart);
+
+	juce::StringArray names;
+	if (!directory.isDirectory())
+		return names;
+
+	for (auto const& file : directory.findChildFiles(juce::File::findFiles, false, namePart + "*"))
+		names.add(directoryPart + file.getFileName());
+	names.sort(false);
+
+	return names;
+}
+
+/**
+ * Checks for leftovers of a write that was interrupted, e.g. by a crash or power loss.
+ * If the journal file exists and the temporary file matches the size recorded in it,
+ * the temporary file is known to be complete and the interrupted rename is finished.
+ * Any other temporary file is incomplete and discarded, leaving the previous file in place.
+ * @param name	The name of the file to recover.
+ * @return	True if no recovery was required or it was successful.
+ */
+bool FileConfigurationStorage::recoverInterruptedWrite(const juce::String& name)
+{
+	auto file = getFile(name);
+	auto tempFile = getFile(name + ".tmp");
+	auto journalFile = getFile(name + ".journal");
+	auto success = true;
+
+	if (journalFile.existsAsFile())
+	{
+		auto journaledSize = journalFile.loadFileAsString().trim();
+		if (tempFile.existsAsFile() && journaledSize.isNotEmpty() && journaledSize.getLargeIntValue() == tempFile.getSize())
+		{
+			DBG(juce::String(__FUNCTION__) + " completing interrupted write of " + file.getFullPathName());
+			success = tempFile.moveFileTo(file);
+		}
+
+		success = journalFile.deleteFile() && success;
+	}
+
+	if (tempFile.existsAsFile())
+	{
+		DBG(juce::String(__FUNCTION__) + " discarding incomplete write of " + file.getFullPathName());
+		success = tempFile.deleteFile() && success;
+	}
+
+	return success;
+}
+
+juce::File FileConfigurationStorage::getFile(const juce::String& name) const
+{
+	return m_directory.getChildFile(name);
+}
+
+juce::String FileConfigurationStorage::getDisplayName(const juce::String& name) const
+{
+	return getFile(name).getFullPathName();
+}
+
+//==============================================================================
+MemoryConfigurationStorage::MemoryConfigurationStorage()
+{
+}
+
+MemoryConfigurationStorage::~MemoryConfigurationStorage()
+{
+}
+
+bool MemoryConfigurationStorage::exists(const juce::String& name) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	return m_blobs.count(name) > 0;
+}
+
+bool MemoryConfigurationStorage::read(const juce::String& name, juce::MemoryBlock& data, juce::int64 maxNumBytes) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	auto blob = m_blobs.find(name);
+	if (blob == m_blobs.end())
+		return false;
+
+	auto numBytes = maxNumBytes < 0 ? blob->second.data.getSize() : juce::jmin(size_t(maxNumBytes), blob->second.data.getSize());
+	data.replaceAll(blob->second.data.getData(), numBytes);
+
+	return true;
+}
+
+/**
+ * Provides the blob in place, while the blobs are locked. readContent must therefore not access this storage.
+ * @param name			The name of the blob to read.
+ * @param readContent	Reads the blob content.
+ * @return	True on success, false if the blob does not exist.
+ */
+bool MemoryConfigurationStorage::readMapped(const juce::String& name, const std::function<void(const void* data, size_t numBytes)>& readContent) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	auto blob = m_blobs.find(name);
+	if (blob == m_blobs.end())
+		return false;
+
+	readContent(blob->second.data.getData(), blob->second.data.getSize());
+	return true;
+}
+
+bool MemoryConfigurationStorage::writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent)
+{
+	// the content is complete before it replaces the previous blob
+	juce::MemoryBlock data;
+	{
+		juce::MemoryOutputStream contentStream(data, false);
+		writeContent(contentStream);
+	}
+
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	putBlob(name, std::move(data));
+
+	return true;
+}
+
+bool MemoryConfigurationStorage::append(const juce::String& name, const void* data, size_t numBytes)
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	appendToBlob(name, data, numBytes);
+
+	return true;
+}
+
+bool MemoryConfigurationStorage::remove(const juce::String& name)
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	m_blobs.erase(name);
+
+	return true;
+}
+
+juce::int64 MemoryConfigurationStorage::getSize(const juce::String& name) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	auto blob = m_blobs.find(name);
+
+	return blob != m_blobs.end() ? juce::int64(blob->second.data.getSize()) : 0;
+}
+
+juce::int64 MemoryConfigurationStorage::getModificationTime(const juce::String& name) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	auto blob = m_blobs.find(name);
+
+	return blob != m_blobs.end() ? blob->second.modificationTime : 0;
+}
+
+juce::StringArray MemoryConfigurationStorage::getNames(const juce::String& prefix) const
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+
+	// the map is sorted, the names with the prefix are consecutive
+	juce::StringArray names;
+	for (auto blob = m_blobs.lower_bound(prefix); blob != m_blobs.end() && blob->first.startsWith(prefix); ++blob)
+		names.add(blob->first);
+
+	return names;
+}
+
+void MemoryConfigurationStorage::putBlob(const juce::String& name, juce::MemoryBlock&& data)
+{
+	auto& blob = m_blobs[name];
+	blob.data = std::move(data);
+	blob.modificationTime = ++m_modificationCounter;
+}
+
+void MemoryConfigurationStorage::appendToBlob(const juce::String& name, const void* data, size_t numBytes)
+{
+	auto& blob = m_blobs[name];
+	blob.data.append(data, numBytes);
+	blob.modificationTime = ++m_modificationCounter;
+}
+
+//==============================================================================
+static constexpr int s_journalRecordMagic = 0x524a4341; // "ACJR"
+
+// detects torn or corrupted records
+static juce::uint64 getRecordChecksum(int type, const juce::String& name, const void* data, size_t numBytes)
+{
+	auto checksum = hashBytes(s_fnvOffsetBasis, &type, sizeof(type));
+	checksum = hashBytes(checksum, name.toRawUTF8(), name.getNumBytesAsUTF8());
+	return hashBytes(checksum, data, numBytes);
+}
+
+JournalConfigurationStorage::JournalConfigurationStorage(const juce::File& journalFile, juce::int64 compactionThresholdBytes)
+	: m_journalFile(journalFile), m_compactionThreshold(compactionThresholdBytes)
+{
+	if (!replayJournal())
+		DBG(juce::String(__FUNCTION__) + " journal " + m_journalFile.getFullPathName() + " ended with an incomplete record");
+}
+
+JournalConfigurationStorage::~JournalConfigurationStorage()
+{
+}
+
+bool JournalConfigurationStorage::writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent)
+{
+	juce::MemoryBlock data;
+	{
+		juce::MemoryOutputStream contentStream(data, false);
+		writeContent(contentStream);
+	}
+
+	// a record is only applied on replay if it is complete, which makes every write atomic
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	if (!appendRecord(RT_Put, name, data.getData(), data.getSize()))
+		return false;
+	putBlob(name, std::move(data));
+
+	return compactJournal();
+}
+
+bool JournalConfigurationStorage::append(const juce::String& name, const void* data, size_t numBytes)
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	if (!appendRecord(RT_Append, name, data, numBytes))
+		return false;
+	appendToBlob(name, data, numBytes);
+
+	return compactJournal();
+}
+
+bool JournalConfigurationStorage::remove(const juce::String& name)
+{
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+	if (m_blobs.count(name) == 0)
+		return true;
+	if (!appendRecord(RT_Remove, name, nullptr, 0))
+		return false;
+	m_blobs.erase(name);
+
+	return compactJournal();
+}
+
+juce::File JournalConfigurationStorage::getFile(const juce::String& name) const
+{
+	juce::ignoreUnused(name);
+	return juce::File(); // the blobs are not accessible as individual files
+}
+
+juce::String JournalConfigurationStorage::getDisplayName(const juce::String& name) const
+{
+	return m_journalFile.getFullPathName() + ":" + name;
+}
+
+/**
+ * Loads the blobs by replaying all complete records of the journal file.
+ * A torn or corrupted record ends the replay and is cut off, so that subsequent
+ * records are not appended behind unreadable data.
+ * @return	True if the journal was replayed completely.
+ */
+bool JournalConfigurationStorage::replayJournal()
+{
+	if (!m_journalFile.existsAsFile())
+		return true;
+
+	juce::MemoryBlock journalData;
+	if (!m_journalFile.loadFileAsData(journalData))
+		return false;
+
+	std::lock_guard<std::mutex> blobslock(m_blobsMutex);
+
+	juce::MemoryInputStream journalStream(journalData, false);
+	auto validSize = juce::int64(0);
+	while (!journalStream.isExhausted())
+	{
+		if (journalStream.readInt() != s_journalRecordMagic)
+			break;
+		auto type = int(journalStream.readByte());
+		auto name = journalStream.readString();
+		auto numBytes = journalStream.readInt64();
+		if (numBytes < 0 || numBytes > journalStream.getNumBytesRemaining())
+			break;
+		juce::MemoryBlock data;
+		journalStream.readIntoMemoryBlock(data, static_cast<ssize_t>(numBytes));
+		if (journalStream.getNumBytesRemaining() < juce::int64(sizeof(juce::int64))
+			|| juce::uint64(journalStream.readInt64()) != getRecordChecksum(type, name, data.getData(), data.getSize()))
+			break;
+
+		if (type == RT_Put)
+			putBlob(name, std::move(data));
+		else if (type == RT_Append)
+			appendToBlob(name, data.getData(), data.getSize());
+		else if (type == RT_Remove)
+			m_blobs.erase(name);
+		else
+			break;
+
+		validSize = journalStream.getPosition();
+	}
+
+	if (validSize == juce::int64(journalData.getSize()))
+		return true;
+
+	juce::FileOutputStream truncateStream(m_journalFile);
+	if (truncateStream.openedOk() && truncateStream.setPosition(validSize))
+		truncateStream.truncate();
+
+	return false;
+}
+
+/**
+ * Appends a record to the journal file and syncs it to disk.
+ * @param type		The type of change.
+ * @param name		The name of the changed blob.
+ * @param data		The record data, the new content for RT_Put or the appended data for RT_Append.
+ * @param numBytes	The size of the record data.
+ * @return	True on success.
+ */
+bool JournalConfigurationStorage::appendRecord(RecordType type, const juce::String& name, const void* data, size_t numBytes)
+{
+	juce::FileOutputStream journalStream(m_journalFile, s_fileBufferSize);
+	if (!journalStream.openedOk())
+		return false;
+
+	writeRecord(journalStream, type, name, data, numBytes);
+	journalStream.flush(); // flushing a FileOutputStream syncs the data to the device as well
+
+	return journalStream.getStatus().wasOk();
+}
+
+/**
+ * Rewrites the journal file with a single record per live blob, if it grew beyond
+ * the compaction threshold and twice the size of the live data.
+ * @return	True if no compaction was required or it was successful.
+ */
+bool JournalConfigurationStorage::compactJournal()
+{
+	auto journalSize = m_journalFile.getSize();
+	if (journalSize <= m_compactionThreshold)
+		return true;
+
+	auto liveSize = juce::int64(0);
+	for (auto const& blob : m_blobs)
+		liveSize += juce::int64(blob.second.data.getSize());
+	if (journalSize <= 2 * liveSize)
+		return true;
+
+	juce::TemporaryFile tempFile(m_journalFile);
+	{
+		juce::FileOutputStream tempStream(tempFile.getFile(), s_fileBufferSize);
+		if (!tempStream.openedOk())
+			return false;
+
+		for (auto const& blob : m_blobs)
+			writeRecord(tempStream, RT_Put, blob.first, blob.second.data.getData(), blob.second.data.getSize());
+		tempStream.flush();
+
+		if (tempStream.getStatus().failed())
+			return false;
+	}
+
+	return tempFile.overwriteTargetFileWithTemporary();
+}
+
+void JournalConfigurationStorage::writeRecord(juce::OutputStream& stream, RecordType type, const juce::String& name, const void* data, size_t numBytes)
+{
+	stream.writeInt(s_journalRecordMagic);
+	stream.writeByte(char(type));
+	stream.writeString(name);
+	stream.writeInt64(juce::int64(numBytes));
+	if (numBytes > 0)
+		stream.write(data, numBytes);
+	stream.writeInt64(juce::int64(getRecordChecksum(int(type), name, data, numBytes)));
+}
+
+}
@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    AppConfigurationStorage.h
+    Created: 17 Oct 2026 3:21:07pm
+    Author:  Christian Ahrens
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace JUCEAppBasics
+{
+
+/**
+ * Storage backend of AppConfigurationBase. The configuration and its auxiliary data
+ * (delta journal, binary snapshot, shards) are stored as named blobs. Names are relative
+ * paths and may contain '/' separators. All methods are called from the message thread
+ * as well as from the flush thread and must be thread-safe.
+ */
+class AppConfigurationStorage
+{
+public:
+	virtual ~AppConfigurationStorage() {};
+
+	virtual bool exists(const juce::String& name) const = 0;
+	virtual bool read(const juce::String& name, juce::MemoryBlock& data, juce::int64 maxNumBytes = -1) const = 0;
+	virtual bool writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent) = 0;
+	virtual bool append(const juce::String& name, const void* data, size_t numBytes) = 0;
+	virtual bool remove(const juce::String& name) = 0;
+
+	virtual juce::int64 getSize(const juce::String& name) const = 0;
+	virtual juce::int64 getModificationTime(const juce::String& name) const = 0;
+	virtual juce::StringArray getNames(const juce::String& prefix) const = 0;
+
+	/**
+	 * Provides the content of a blob without copying it, if the backend is able to. The default
+	 * implementation reads the blob into memory. The data is only valid within readContent.
+	 */
+	virtual bool readMapped(const juce::String& name, const std::function<void(const void* data, size_t numBytes)>& readContent) const
+	{
+		juce::MemoryBlock data;
+		if (!read(name, data))
+			return false;
+
+		readContent(data.getData(), data.getSize());
+		return true;
+	};
+	virtual bool recoverInterruptedWrite(const juce::String& name)
+	{
+		juce::ignoreUnused(name);
+		return true;
+	};
+	virtual juce::File getFile(const juce::String& name) const
+	{
+		juce::ignoreUnused(name);
+		return juce::File();
+	};
+	virtual juce::String getDisplayName(const juce::String& name) const
+	{
+		return name;
+	};
+};
+
+/**
+ * Stores the blobs as files in a directory. Atomic writes go through a temporary file
+ * and a small journal file, to be able to complete or discard an interrupted write.
+ */
+class FileConfigurationStorage : public AppConfigurationStorage
+{
+public:
+	explicit FileConfigurationStorage(const juce::File& directory);
+	~FileConfigurationStorage() override;
+
+	bool exists(const juce::String& name) const override;
+	bool read(const juce::String& name, juce::MemoryBlock& data, juce::int64 maxNumBytes = -1) const override;
+	bool writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent) override;
+	bool append(const juce::String& name, const void* data, size_t numBytes) override;
+	bool remove(const juce::String& name) override;
+
+	juce::int64 getSize(const juce::String& name) const override;
+	juce::int64 getModificationTime(const juce::String& name) const override;
+	juce::StringArray getNames(const juce::String& prefix) const override;
+
+	bool readMapped(const juce::String& name, const std::function<void(const void* data, size_t numBytes)>& readContent) const override;
+
+	bool recoverInterruptedWrite(const juce::String& name) override;
+	juce::File getFile(const juce::String& name) const override;
+	juce::String getDisplayName(const juce::String& name) const override;
+
+private:
+	juce::File	m_directory;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileConfigurationStorage)
+};
+
+/**
+ * Keeps the blobs in memory only, e.g. for tests and benchmarks that run many
+ * configuration cycles without touching the disk. Modification times are a
+ * counter that increases with every change.
+ */
+class MemoryConfigurationStorage : public AppConfigurationStorage
+{
+public:
+	MemoryConfigurationStorage();
+	~MemoryConfigurationStorage() override;
+
+	bool exists(const juce::String& name) const override;
+	bool read(const juce::String& name, juce::MemoryBlock& data, juce::int64 maxNumBytes = -1) const override;
+	bool writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent) override;
+	bool append(const juce::String& name, const void* data, size_t numBytes) override;
+	bool remove(const juce::String& name) override;
+
+	juce::int64 getSize(const juce::String& name) const override;
+	juce::int64 getModificationTime(const juce::String& name) const override;
+	juce::StringArray getNames(const juce::String& prefix) const override;
+
+	bool readMapped(const juce::String& name, const std::function<void(const void* data, size_t numBytes)>& readContent) const override;
+
+protected:
+	struct Blob
+	{
+		juce::MemoryBlock	data;
+		juce::int64			modificationTime{ 0 };
+	};
+
+	void putBlob(const juce::String& name, juce::MemoryBlock&& data);	// expects m_blobsMutex to be locked
+	void appendToBlob(const juce::String& name, const void* data, size_t numBytes);	// expects m_blobsMutex to be locked
+
+	std::map<juce::String, Blob>	m_blobs;
+	juce::int64						m_modificationCounter{ 0 };
+	mutable std::mutex				m_blobsMutex;
+
+private:
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MemoryConfigurationStorage)
+};
+
+/**
+ * Embedded key-value store keeping all blobs in memory, persisted as a single append-only
+ * journal file. Every change is appended as checksummed record and synced to disk, so even
+ * writing a large blob is a single sequential append. On startup, the records are replayed
+ * and a torn last record is discarded. The journal is compacted to the live blobs as soon as
+ * it grows beyond the given threshold and twice the size of the live data.
+ */
+class JournalConfigurationStorage : public MemoryConfigurationStorage
+{
+public:
+	explicit JournalConfigurationStorage(const juce::File& journalFile, juce::int64 compactionThresholdBytes = 4 * 1024 * 1024);
+	~JournalConfigurationStorage() override;
+
+	bool writeAtomically(const juce::String& name, const std::function<void(juce::OutputStream&)>& writeContent) override;
+	bool append(const juce::String& name, const void* data, size_t numBytes) override;
+	bool remove(const juce::String& name) override;
+
+	juce::File getFile(const juce::String& name) const override;
+	juce::String getDisplayName(const juce::String& name) const override;
+
+private:
+	enum RecordType
+	{
+		RT_Put = 1,
+		RT_Append,
+		RT_Remove,
+	};
+
+	bool replayJournal();
+	bool appendRecord(RecordType type, const juce::String& name, const void* data, size_t numBytes);	// expects m_blobsMutex to be locked
+	bool compactJournal();	// expects m_blobsMutex to be locked
+
+	static void writeRecord(juce::OutputStream& stream, RecordType type, const juce::String& name, const void* data, size_t numBytes);
+
+	juce::File	m_journalFile;
+	juce::int64	m_compactionThreshold{ 4 * 1024 * 1024 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JournalConfigurationStorage)
+};
+
+}
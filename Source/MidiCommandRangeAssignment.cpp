@@ -18,7 +18,7 @@ MidiCommandRangeAssignment::MidiCommandRangeAssignment()
 {
 }
 
-MidiCommandRangeAssignment::MidiCommandRangeAssignment(const std::vector<std::uint8_t>& commandData)
+MidiCommandRangeAssignment::MidiCommandRangeAssignment(const CommandData& commandData)
 {
     setCommandData(commandData);
 }
@@ -29,10 +29,6 @@ MidiCommandRangeAssignment::MidiCommandRangeAssignment(const juce::MidiMessage&
     extendValueRange(m);
 }
 
-MidiCommandRangeAssignment::~MidiCommandRangeAssignment()
-{
-}
-
 bool MidiCommandRangeAssignment::operator==(const MidiCommandRangeAssignment& rhs) const
 {
     return (m_commandData == rhs.m_commandData && m_valueRange == rhs.m_valueRange && m_commandRange == rhs.m_commandRange);
@@ -76,19 +72,7 @@ bool MidiCommandRangeAssignment::operator>(const MidiCommandRangeAssignment& rhs
     return ((m_commandData == rhs.m_commandData) && (valueRangeGreaterThanRhs || commandRangeGreaterThanRhs));
 }
 
-MidiCommandRangeAssignment& MidiCommandRangeAssignment::operator=(const MidiCommandRangeAssignment& rhs)
-{
-    if (this != &rhs)
-    {
-        m_valueRange = rhs.m_valueRange;
-        m_commandRange = rhs.m_commandRange;
-        m_commandData = rhs.m_commandData;
-    }
-
-    return *this;
-}
-
-std::uint64_t MidiCommandRangeAssignment::getAsValue(const std::vector<std::uint8_t>& data)
+std::uint64_t MidiCommandRangeAssignment::getAsValue(const CommandData& data)
 {
     if (data.size() <= 8 && data.size() > 0) // more than 8 bytes won't fit into a uint64
     {
@@ -115,7 +99,7 @@ juce::String MidiCommandRangeAssignment::getCommandDescription() const
     return getCommandDescription(m_commandData);
 }
 
-juce::String MidiCommandRangeAssignment::getCommandDescription(const std::vector<std::uint8_t>& commandData)
+juce::String MidiCommandRangeAssignment::getCommandDescription(const CommandData& commandData)
 {
     if (isNoteOnCommand(commandData) && (commandData.size() > 1))
         return "NoteOn " + juce::MidiMessage::getMidiNoteName(commandData[1], true, true, 3);
@@ -185,7 +169,7 @@ bool MidiCommandRangeAssignment::isChannelPressureCommand() const
     return isChannelPressureCommand(m_commandData);
 }
 
-bool MidiCommandRangeAssignment::isNoteOnCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isNoteOnCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -196,7 +180,7 @@ bool MidiCommandRangeAssignment::isNoteOnCommand(const std::vector<std::uint8_t>
         return false;
 }
 
-bool MidiCommandRangeAssignment::isNoteOffCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isNoteOffCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -209,7 +193,7 @@ bool MidiCommandRangeAssignment::isNoteOffCommand(const std::vector<std::uint8_t
         return false;
 }
 
-bool MidiCommandRangeAssignment::isProgramChangeCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isProgramChangeCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -217,7 +201,7 @@ bool MidiCommandRangeAssignment::isProgramChangeCommand(const std::vector<std::u
     return ((commandData[0] & 0xf0) == 0xc0);
 }
 
-bool MidiCommandRangeAssignment::isPitchCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isPitchCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -225,7 +209,7 @@ bool MidiCommandRangeAssignment::isPitchCommand(const std::vector<std::uint8_t>&
     return ((commandData[0] & 0xf0) == 0xe0);
 }
 
-bool MidiCommandRangeAssignment::isAftertouchCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isAftertouchCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -233,7 +217,7 @@ bool MidiCommandRangeAssignment::isAftertouchCommand(const std::vector<std::uint
     return ((commandData[0] & 0xf0) == 0xa0);
 }
 
-bool MidiCommandRangeAssignment::isControllerCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isControllerCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -241,7 +225,7 @@ bool MidiCommandRangeAssignment::isControllerCommand(const std::vector<std::uint
     return ((commandData[0] & 0xf0) == 0xb0);
 }
 
-bool MidiCommandRangeAssignment::isChannelPressureCommand(const std::vector<std::uint8_t>& commandData)
+bool MidiCommandRangeAssignment::isChannelPressureCommand(const CommandData& commandData)
 {
     if (commandData.empty())
         return false;
@@ -293,7 +277,7 @@ MidiCommandRangeAssignment::CommandType MidiCommandRangeAssignment::getCommandTy
     return commandType;
 }
 
-MidiCommandRangeAssignment::CommandType MidiCommandRangeAssignment::getCommandType(const std::vector<std::uint8_t>& commandData)
+MidiCommandRangeAssignment::CommandType MidiCommandRangeAssignment::getCommandType(const CommandData& commandData)
 {
     auto mcra = MidiCommandRangeAssignment();
     mcra.setCommandData(commandData);
@@ -306,7 +290,7 @@ bool MidiCommandRangeAssignment::isMatchingCommandType(const juce::MidiMessage&
     return getCommandType() == getCommandType(m);
 }
 
-bool MidiCommandRangeAssignment::isMatchingCommandType(const std::vector<std::uint8_t>& commandData) const
+bool MidiCommandRangeAssignment::isMatchingCommandType(const CommandData& commandData) const
 {
     return getCommandType() == getCommandType(commandData);
 }
@@ -362,7 +346,7 @@ int MidiCommandRangeAssignment::getCommandValue(const juce::MidiMessage& m)
     }
 }
 
-int MidiCommandRangeAssignment::getCommandValue(const std::vector<std::uint8_t>& commandData)
+int MidiCommandRangeAssignment::getCommandValue(const CommandData& commandData)
 {
     if (commandData.size() < 2)
         return -1;
@@ -401,7 +385,7 @@ int MidiCommandRangeAssignment::getCommandChannel() const
         return -1;
 }
 
-int MidiCommandRangeAssignment::getCommandChannel(const std::vector<std::uint8_t>& commandData)
+int MidiCommandRangeAssignment::getCommandChannel(const CommandData& commandData)
 {
     if (commandData.size() < 1)
         return 0;
@@ -439,19 +423,17 @@ juce::String MidiCommandRangeAssignment::getNiceDescription() const
         return getCommandDescription();
 }
 
-const std::vector<std::uint8_t>& MidiCommandRangeAssignment::getCommandData() const
+const MidiCommandRangeAssignment::CommandData& MidiCommandRangeAssignment::getCommandData() const
 {
     return m_commandData;
 }
 
-std::vector<std::uint8_t> MidiCommandRangeAssignment::getCommandData(const juce::MidiMessage& m)
+MidiCommandRangeAssignment::CommandData MidiCommandRangeAssignment::getCommandData(const juce::MidiMessage& m)
 {
     auto dataBytes = m.getRawData();
     auto dataBytesLength = m.getRawDataSize();
-    auto commandData = std::vector<std::uint8_t>();
+    auto commandData = CommandData();
     auto commandDataExpectedByteCount = getCommandDataExpectedBytes(m);
-
-    commandData.reserve(commandDataExpectedByteCount);
     
     if (commandDataExpectedByteCount > dataBytesLength)
         return commandData;
@@ -515,7 +497,7 @@ bool MidiCommandRangeAssignment::isCommandTriggerAssignment() const
     return !getCommandData().empty() && !isValueRangeAssignment() && !isCommandRangeAssignment();
 }
 
-void MidiCommandRangeAssignment::setCommandData(const std::vector<std::uint8_t>& commandData)
+void MidiCommandRangeAssignment::setCommandData(const CommandData& commandData)
 {
     m_commandData = commandData;
 }
@@ -591,17 +573,22 @@ bool MidiCommandRangeAssignment::isMatchingValueRange(const juce::MidiMessage& m
     return isMatchingValueRange(getValue(m));
 }
 
-const juce::Range<std::vector<std::uint8_t>>& MidiCommandRangeAssignment::getCommandRange() const
+const juce::Range<MidiCommandRangeAssignment::CommandData>& MidiCommandRangeAssignment::getCommandRange() const
 {
     return m_commandRange;
 }
 
-void MidiCommandRangeAssignment::setCommandRange(const juce::Range<std::vector<std::uint8_t>>& cr)
+void MidiCommandRangeAssignment::setCommandRange(const juce::Range<CommandData>& cr)
 {
     m_commandRange = cr;
 }
 
-bool MidiCommandRangeAssignment::extendCommandRange(const std::vector<std::uint8_t>& c)
+void MidiCommandRangeAssignment::setCommandRange(const juce::Range<std::vector<std::uint8_t>>& cr)
+{
+    setCommandRange(juce::Range<CommandData>(cr.getStart(), cr.getEnd()));
+}
+
+bool MidiCommandRangeAssignment::extendCommandRange(const CommandData& c)
 {
     if (isMatchingCommandRange(c))
         return false;
@@ -632,14 +619,14 @@ bool MidiCommandRangeAssignment::extendCommandRange(const std::vector<std::uint8
         {
             auto commandValue = getCommandValue();
             if (commandValue > newCommandValue)
-                setCommandRange(juce::Range<std::vector<std::uint8_t>>(c, m_commandData));
+                setCommandRange(juce::Range<CommandData>(c, m_commandData));
             else if (commandValue < newCommandValue)
-                setCommandRange(juce::Range<std::vector<std::uint8_t>>(m_commandData, c));
+                setCommandRange(juce::Range<CommandData>(m_commandData, c));
             else
                 return false;
         }
         else
-            setCommandRange(juce::Range<std::vector<std::uint8_t>>(c, c));
+            setCommandRange(juce::Range<CommandData>(c, c));
         
         return true;
     }
@@ -686,7 +673,7 @@ bool MidiCommandRangeAssignment::isMatchingCommand(const juce::MidiMessage& m) c
     return match;
 }
 
-bool MidiCommandRangeAssignment::isMatchingCommandRange(const std::vector<std::uint8_t>& c) const
+bool MidiCommandRangeAssignment::isMatchingCommandRange(const CommandData& c) const
 {
     if (!isCommandRangeAssignment())
         return false;
@@ -728,7 +715,7 @@ bool MidiCommandRangeAssignment::isMatchingCommandRange(const juce::MidiMessage&
  */
 juce::String MidiCommandRangeAssignment::serializeToHexString() const
 {
-    auto serialData = m_commandData;
+    auto serialData = std::vector<std::uint8_t>(m_commandData.begin(), m_commandData.end());
     if (isValueRangeAssignment() || isCommandRangeAssignment())
     {
         // The start/end int values are stored as two additional bytes each at the end of the data buffer
@@ -784,8 +771,8 @@ bool MidiCommandRangeAssignment::deserializeFromHexString(const juce::String& se
     // Save the current command data to be able to restore it, if something goes wrong
     auto commandDataStash = m_commandData;
     
-    // Take over the just read byte vector into internal command data, to be able to use internal processing methods on ut
-    m_commandData = byteData;
+    // Take over the leading bytes of the just read byte vector into internal command data, to be able to use internal processing methods on it
+    m_commandData = CommandData(byteData.data(), juce::jmin(byteDataLength, CommandData::capacity));
     auto newCommandDataByteLength = getCommandDataExpectedBytes(); // this relies on m_commandData (which is why we already modified it in the prev. line)
     // If the command data length is zero, something went wrong and we did not recognize the command
     jassert(newCommandDataByteLength != 0);
@@ -817,15 +804,13 @@ bool MidiCommandRangeAssignment::deserializeFromHexString(const juce::String& se
                     cmdRangeBytePos++;
 
                     // If we have four additional bytes and a straight number of bytes on top, we assume a value range 
-                    // followed by a command range being encoded in the additional bytes
-                    if (((cmdRangeByteCount) % 2 == 0) && ((byteData.size() - cmdRangeBytePos) % 2 == 0))
+                    // followed by a command range being encoded in the additional bytes (each half fitting into command data)
+                    if (((cmdRangeByteCount) % 2 == 0) && ((byteData.size() - cmdRangeBytePos) % 2 == 0) && (cmdRangeByteCount / 2 <= int(CommandData::capacity)))
                     {
                         // we assume that half of the command range bytes are start and half are end value
                         auto rangeValByteCount = cmdRangeByteCount / 2;
-                        auto rangeStart = std::vector<std::uint8_t>();
-                        rangeStart.reserve(rangeValByteCount);
-                        auto rangeEnd = std::vector<std::uint8_t>();
-                        rangeEnd.reserve(rangeValByteCount);
+                        auto rangeStart = CommandData();
+                        auto rangeEnd = CommandData();
                         auto i = 0;
                         for (; i < rangeValByteCount; ++i)
                             rangeStart.push_back(byteData.at(cmdRangeBytePos + i));
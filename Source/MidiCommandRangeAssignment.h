@@ -12,6 +12,9 @@
 
 #include <JuceHeader.h>
 
+#include <array>
+#include <type_traits>
+
 namespace JUCEAppBasics
 {
 
@@ -31,19 +34,77 @@ public:
         CT_ChannelPressure,
     };
 
+    /**
+     * Inline storage for the up to three bytes of a MIDI channel message.
+     * It mimics the parts of std::vector<std::uint8_t> used on command data and converts to and from
+     * it implicitly, but never allocates, to keep assignments usable on realtime MIDI threads.
+     */
+    class CommandData
+    {
+    public:
+        static constexpr std::size_t capacity = 3;
+
+        CommandData() = default;
+        CommandData(const std::uint8_t* data, std::size_t numBytes)
+        {
+            jassert(numBytes <= capacity);
+            for (auto i = std::size_t(0); i < numBytes && i < capacity; ++i)
+                push_back(data[i]);
+        }
+        CommandData(std::initializer_list<std::uint8_t> bytes) : CommandData(bytes.begin(), bytes.size()) {}
+        CommandData(const std::vector<std::uint8_t>& bytes) : CommandData(bytes.data(), bytes.size()) {}
+
+        operator std::vector<std::uint8_t>() const { return std::vector<std::uint8_t>(begin(), end()); }
+
+        std::size_t size() const noexcept { return m_size; }
+        bool empty() const noexcept { return m_size == 0; }
+
+        const std::uint8_t* data() const noexcept { return m_bytes.data(); }
+        const std::uint8_t* begin() const noexcept { return m_bytes.data(); }
+        const std::uint8_t* end() const noexcept { return m_bytes.data() + m_size; }
+
+        std::uint8_t operator[](std::size_t index) const noexcept { jassert(index < m_size); return m_bytes[index]; }
+        std::uint8_t at(std::size_t index) const noexcept { jassert(index < m_size); return index < capacity ? m_bytes[index] : std::uint8_t(0); }
+
+        void push_back(std::uint8_t byte) noexcept
+        {
+            jassert(m_size < capacity);
+            if (m_size < capacity)
+                m_bytes[m_size++] = byte;
+        }
+        void resize(std::size_t numBytes) noexcept
+        {
+            jassert(numBytes <= capacity);
+            for (auto i = std::size_t(m_size); i < numBytes && i < capacity; ++i)
+                m_bytes[i] = 0;
+            m_size = static_cast<std::uint8_t>(juce::jmin(numBytes, capacity));
+        }
+        void clear() noexcept { m_size = 0; }
+
+        /** Equality and lexicographical order match those of std::vector, which juce::Range relies on. */
+        friend bool operator==(const CommandData& lhs, const CommandData& rhs) noexcept { return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()); }
+        friend bool operator!=(const CommandData& lhs, const CommandData& rhs) noexcept { return !(lhs == rhs); }
+        friend bool operator<(const CommandData& lhs, const CommandData& rhs) noexcept { return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()); }
+        friend bool operator>(const CommandData& lhs, const CommandData& rhs) noexcept { return rhs < lhs; }
+        friend bool operator<=(const CommandData& lhs, const CommandData& rhs) noexcept { return !(rhs < lhs); }
+        friend bool operator>=(const CommandData& lhs, const CommandData& rhs) noexcept { return !(lhs < rhs); }
+
+    private:
+        std::array<std::uint8_t, capacity>  m_bytes{};
+        std::uint8_t                        m_size{ 0 };
+    };
+
 public:
     MidiCommandRangeAssignment();
-    MidiCommandRangeAssignment(const std::vector<std::uint8_t>& commandData);
+    MidiCommandRangeAssignment(const CommandData& commandData);
     MidiCommandRangeAssignment(const juce::MidiMessage& m);
-    ~MidiCommandRangeAssignment();
 
     bool operator==(const MidiCommandRangeAssignment& rhs) const;
     bool operator!=(const MidiCommandRangeAssignment& rhs) const;
     bool operator<(const MidiCommandRangeAssignment& rhs) const;
 	bool operator>(const MidiCommandRangeAssignment& rhs) const;
-    MidiCommandRangeAssignment& operator=(const MidiCommandRangeAssignment& rhs);
 
-    static std::uint64_t getAsValue(const std::vector<std::uint8_t>& data);
+    static std::uint64_t getAsValue(const CommandData& data);
 
     bool isNoteOnCommand() const;
     bool isNoteOffCommand() const;
@@ -53,29 +114,29 @@ public:
     bool isControllerCommand() const;
     bool isChannelPressureCommand() const;
 
-    static bool isNoteOnCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isNoteOffCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isProgramChangeCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isPitchCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isAftertouchCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isControllerCommand(const std::vector<std::uint8_t>& commandData);
-    static bool isChannelPressureCommand(const std::vector<std::uint8_t>& commandData);
+    static bool isNoteOnCommand(const CommandData& commandData);
+    static bool isNoteOffCommand(const CommandData& commandData);
+    static bool isProgramChangeCommand(const CommandData& commandData);
+    static bool isPitchCommand(const CommandData& commandData);
+    static bool isAftertouchCommand(const CommandData& commandData);
+    static bool isControllerCommand(const CommandData& commandData);
+    static bool isChannelPressureCommand(const CommandData& commandData);
 
     CommandType getCommandType() const;
     static CommandType getCommandType(const juce::MidiMessage& m);
-    static CommandType getCommandType(const std::vector<std::uint8_t>& commandData);
+    static CommandType getCommandType(const CommandData& commandData);
     bool isMatchingCommandType(const juce::MidiMessage& m) const;
-    bool isMatchingCommandType(const std::vector<std::uint8_t>& commandData) const;
+    bool isMatchingCommandType(const CommandData& commandData) const;
 
     juce::String getCommandDescription() const;
-    static juce::String getCommandDescription(const std::vector<std::uint8_t>& commandData);
+    static juce::String getCommandDescription(const CommandData& commandData);
     juce::String getValueRangeDescription() const;
     juce::String getCommandRangeDescription() const;
     juce::String getNiceDescription() const;
 
-    const std::vector<std::uint8_t>& getCommandData() const;
-    static std::vector<std::uint8_t> getCommandData(const juce::MidiMessage& m);
-    void setCommandData(const std::vector<std::uint8_t>& commandData);
+    const CommandData& getCommandData() const;
+    static CommandData getCommandData(const juce::MidiMessage& m);
+    void setCommandData(const CommandData& commandData);
     void setCommandData(const juce::MidiMessage& m);
     int getCommandDataExpectedBytes() const;
     static int getCommandDataExpectedBytes(const juce::MidiMessage& m);
@@ -93,31 +154,33 @@ public:
 
     int getCommandValue() const;
     static int getCommandValue(const juce::MidiMessage& m);
-    static int getCommandValue(const std::vector<std::uint8_t>& commandData);
+    static int getCommandValue(const CommandData& commandData);
 
     int getCommandChannel() const;
-    static int getCommandChannel(const std::vector<std::uint8_t>& commandData);
+    static int getCommandChannel(const CommandData& commandData);
 
-    const juce::Range<std::vector<std::uint8_t>>& getCommandRange() const;
+    const juce::Range<CommandData>& getCommandRange() const;
+    void setCommandRange(const juce::Range<CommandData>& cr);
     void setCommandRange(const juce::Range<std::vector<std::uint8_t>>& cr);
-    bool extendCommandRange(const std::vector<std::uint8_t>& c);
+    bool extendCommandRange(const CommandData& c);
     bool extendCommandRange(const juce::MidiMessage& m);
     bool isCommandRangeAssignment() const;
     bool isMatchingCommand(const juce::MidiMessage& m) const;
-    bool isMatchingCommandRange(const std::vector<std::uint8_t>& c) const;
+    bool isMatchingCommandRange(const CommandData& c) const;
     bool isMatchingCommandRange(const juce::MidiMessage& m) const;
 
     juce::String serializeToHexString() const;
     bool deserializeFromHexString(const juce::String& serialData);
 
 private:
-    std::vector<std::uint8_t>               m_commandData;
-    juce::Range<int>                        m_valueRange;
-    juce::Range<std::vector<std::uint8_t>>  m_commandRange;
-    bool                                    m_valueRangeEmpty{ true };
-
-    JUCE_LEAK_DETECTOR(MidiCommandRangeAssignment)
+    CommandData                 m_commandData;
+    juce::Range<int>            m_valueRange;
+    juce::Range<CommandData>    m_commandRange;
+    bool                        m_valueRangeEmpty{ true };
 };
 
+static_assert(std::is_trivially_copyable<MidiCommandRangeAssignment>::value,
+    "MidiCommandRangeAssignment is copied on realtime MIDI threads and must not allocate");
+
 
 }